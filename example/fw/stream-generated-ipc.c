@@ -86,10 +86,10 @@ IPCT_DECLARE_TUPLE_ELEMS(stream_config_opt,
  * ipc: member=b
  */
 IPCT_DECLARE_TUPLE_ELEMS(stream_color_man,
-	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_ID, ipct_type_uint32_value,
+	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_COLOR_A, ipct_type_uint32_value,
 			offsetof(struct stream_color, a),
 			0, 31),
-	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_NAME, ipct_type_uint32_value,
+	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_COLOR_B, ipct_type_uint32_value,
 			offsetof(struct stream_color, b),
 			0, 31),
 );
@@ -112,15 +112,22 @@ IPCT_DECLARE_TUPLE_ELEMS(stream_chmap_man,
 			STREAM_ID_MIN, STREAM_ID_MAX),
 	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_NAME, ipct_type_string,
 			offsetof(struct stream_chmap, name),
-			STREAM_CHMAP_NAME_SIZE, 0),
+			STREAM_CHMAP_NAME_SIZE, STREAM_CHMAP_NAME_SIZE),
 );
 
+/* descriptors for child structures of stream_chmap */
+IPCT_DECLARE_SUBACTION_DESC(stream_chmap,
+	IPCT_DECLARE_SUBACTION_ELEM(color, stream_chmap,
+			IPCT_TUPLES(stream_color_man),
+			IPCT_NOTUPLES,
+			STREAM_CHMAP_COLOR_SIZE, IPCT_NOSUBACTION));
+
 /* descriptors for child structures of stream_params */
 IPCT_DECLARE_SUBACTION_DESC(stream_params,
 	IPCT_DECLARE_SUBACTION_ELEM(chmap, stream_params,
 			IPCT_TUPLES(stream_chmap_man),
 			IPCT_NOTUPLES,
-			0, IPCT_NOSUBACTION));
+			STREAM_CHANNEL_MAX, IPCT_SUBACTION(stream_chmap)));
 
 /* descriptor for struct stream_params */
 IPCT_DECLARE_ACTION_DESC(stream_params,
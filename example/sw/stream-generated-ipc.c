@@ -86,10 +86,10 @@ IPCT_DECLARE_TUPLE_ELEMS(stream_config_opt,
  * ipc: member=b
  */
 IPCT_DECLARE_TUPLE_ELEMS(stream_color_man,
-	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_ID, ipct_type_uint32_value,
+	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_COLOR_A, ipct_type_uint32_value,
 			offsetof(struct alsa_stream_color, a),
 			0, 32),
-	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_NAME, ipct_type_uint32_value,
+	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_COLOR_B, ipct_type_uint32_value,
 			offsetof(struct alsa_stream_color, b),
 			0, 32),
 );
@@ -112,15 +112,22 @@ IPCT_DECLARE_TUPLE_ELEMS(stream_chmap_man,
 			ALSA_STREAM_ID_MIN, ALSA_STREAM_ID_MAX),
 	IPCT_TUPLE_ELEM(STREAM_PARAMS_CHMAP_NAME, ipct_type_string,
 			offsetof(struct alsa_stream_chmap, name),
-			ALSA_STREAM_CHMAP_NAME_SIZE, 0),
+			ALSA_STREAM_CHMAP_NAME_SIZE, ALSA_STREAM_CHMAP_NAME_SIZE),
 );
 
+/* descriptors for child structures of alsa_stream_chmap */
+IPCT_DECLARE_SUBACTION_DESC(alsa_stream_chmap,
+	IPCT_DECLARE_SUBACTION_ELEM(color, alsa_stream_chmap,
+			IPCT_TUPLES(stream_color_man),
+			IPCT_NOTUPLES,
+			ALSA_STREAM_CHMAP_COLOR_SIZE, IPCT_NOSUBACTION));
+
 /* descriptors for child structures of stream_params */
 IPCT_DECLARE_SUBACTION_DESC(alsa_hw_params,
 	IPCT_DECLARE_SUBACTION_ELEM(chmap, alsa_hw_params,
 			IPCT_TUPLES(stream_chmap_man),
 			IPCT_NOTUPLES,
-			0, IPCT_NOSUBACTION));
+			ALSA_STREAM_CHANNEL_MAX, IPCT_SUBACTION(alsa_stream_chmap)));
 
 /* descriptor for struct alsa_hw_params */
 IPCT_DECLARE_ACTION_DESC(alsa_hw_params,
@@ -55,9 +55,17 @@ static int sw_stream_params(struct alsa_stream_context *ctx)
 	params.sample_valid_bytes = 4;
 	params.id = 20;
 
+	/* check the message fits in the mailbox before packing */
+	size = ipct_msg_packed_size(STREAM_ACTION(STREAM_ACTION_PARAMS),
+				    IPCT_FLAGS_REPLY_ACK, 0);
+	if (size < 0 || size > MAILBOX_SIZE) {
+		fprintf(stderr, "error: stream params size %d too big\n", size);
+		return -EINVAL;
+	}
+
 	/* reply to the host with stream information */
 	size = ipct_msg_pack(STREAM_ACTION(STREAM_ACTION_PARAMS), &params, sizeof(params),
-			    mailbox, MAILBOX_SIZE, IPCT_FLAGS_REPLY_ACK, 0);
+			    mailbox, size, IPCT_FLAGS_REPLY_ACK, 0);
 	if (size < 0) {
 		fprintf(stderr, "error: failed to pack stream params\n");
 		return size;
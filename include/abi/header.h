@@ -18,6 +18,28 @@
 
 #include <stdint.h>
 
+/*
+ * IPCT ABI version. The major version changes when the wire layout of the
+ * headers or tuples changes, peers must use the same major version.
+ *
+ * 1.0.0 - initial ABI.
+ * 2.0.0 - struct ipct_elem_var_array has a 16 bit reserved field after
+ *         elem_bytes so array data is word aligned. reserved must be 0.
+ *         struct ipct_hdr bit 29 is now the block bit and vendor is the
+ *         top 2 bits (was 3), there are no free bits left in the header.
+ *         Micro messages set hdr.block with hdr.elems clear so they are
+ *         told apart from nano messages by the header alone.
+ */
+#define IPCT_ABI_MAJOR		2
+#define IPCT_ABI_MINOR		0
+#define IPCT_ABI_PATCH		0
+
+#define IPCT_ABI_VER(major, minor, patch) \
+	(((major) << 24) | ((minor) << 12) | (patch))
+
+#define IPCT_ABI_VERSION \
+	IPCT_ABI_VER(IPCT_ABI_MAJOR, IPCT_ABI_MINOR, IPCT_ABI_PATCH)
+
 /** \addtogroup IPCT_uapi uAPI
  *  IPCT uAPI specification.
  *
@@ -52,7 +74,8 @@
  *
  * 2) Micro messaging via 64bit message and reply - send and reply header with
  *    micro tuple. Expands uses cases from 1) to support stopping and starting
- *    targeted events.
+ *    targeted events. The micro tuple follows when hdr.block = 1 and
+ *    hdr.elems = 0, data blocks always have elems.
  *
  * 3) Variable size message and reply - like 1) and 2) but messages and replies
  *    can be variable in size from 32bits upwards. Any use case can be supported
@@ -95,7 +118,8 @@ struct ipct_hdr {
 	uint32_t datagram : 1;		/**< is datagram - no reply needed */
 	uint32_t route : 1;		/**< sof_ipct_route is appended */
 	uint32_t elems : 1;		/**< sof_ipct_elems is appended */
-	uint32_t vendor : 3;		/**< MSBs TBD by vendor */
+	uint32_t block : 1;		/**< data block or micro - ABI 2.0 */
+	uint32_t vendor : 2;		/**< MSBs TBD by vendor - 3 bits in 1.0 */
 } __attribute__((packed, aligned(4)));
 
 /*
@@ -68,6 +68,8 @@
  * but uses existing or legacy IPC ABI structures.
  *
  * Private data block only mode is enabled by setting hdr.block = 1.
+ * The block is padded to a word and its size is in elems.size with
+ * elems.num_tuples = 0.
  *
  *
  * Tuples
@@ -180,11 +182,16 @@ struct ipct_elem_micro_array {
  * Variable tuple array type that can be used for array of variable size byte data.
  * (tuple.type = IPCT_TUPLE_TYPE_VAR_ARRAY). Can represent a continuous array
  * of 2^16 tuples starting at tuple.id of element size 2 bytes.
+ *
+ * (tuple.type = IPCT_TUPLE_TYPE_TUPLE_ARRAY) is an array of C structures where
+ * each element holds the tuples for one structure. tuple.id is the lowest
+ * tuple ID used by the structure and elements start on a word boundary.
  */
 struct ipct_elem_var_array {
 	struct ipct_tuple tuple;	/* tuple ID (of array[0]) and type */
 	uint16_t count;			/* tuple array count */
 	uint16_t elem_bytes;		/* array element size in bytes */
+	uint16_t reserved;		/* word aligns data - must be 0, ABI 2.0 */
 	uint8_t data[];			/* tuple data */
 } __attribute__((packed, aligned(4)));
 
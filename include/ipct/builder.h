@@ -66,6 +66,7 @@ struct ipct_tuple_elem {
 	uint16_t id;		/* mandatory - tuple ID */
 	uint16_t type;		/* mandatory - ipct_tuple_type */
 	uint32_t offset;	/* mandatory - offset (bytes) in C struct */
+	uint32_t count;		/* optional - C array elems or 0 for one */
 	unsigned long value1;	/* optional - validation value 1 */
 	unsigned long value2;	/* optional - validation value 2 */
 };
@@ -80,12 +81,43 @@ struct ipct_tuple_elem {
 	.value2		= tval2,					\
 }
 
+/*
+ * Convenience macro for a C array member of tcount numeric values. The array
+ * uses tuple IDs tid to tid + tcount - 1 and is packed as a single tuple
+ * array. The validation values apply to every array elem.
+ */
+#define IPCT_TUPLE_ELEM_ARRAY(tid, ttype, toffset, tcount, tval1, tval2)	\
+{									\
+	.id		= tid,						\
+	.type		= ttype,					\
+	.offset		= toffset,					\
+	.count		= tcount,					\
+	.value1		= tval1,					\
+	.value2		= tval2,					\
+}
+
 /* Convenience to build an array of tuple elems */
 #define IPCT_DECLARE_TUPLE_ELEMS(tname, ...)				\
 	const struct ipct_tuple_elem tname ## _tuples[] = {		\
 		__VA_ARGS__						\
 }
 
+/*
+ * Worst case packed message size in bytes for a C structure of struct_bytes
+ * described by num_elems tuple elems. This is a compile time constant for
+ * statically declared actions and can be used to size message buffers, e.g.
+ *
+ * IPCT_MSG_MAX_SIZE(sizeof(struct foo), ARRAY_SIZE(foo_man_tuples))
+ *
+ * Each elem has at most a tuple header and word padding and 8 bit data is
+ * packed into 16 bit micro tuples. Elems in subaction arrays are counted once
+ * per array element plus two for each subaction array tuple header.
+ * ipct_msg_max_size() is exact at runtime.
+ */
+#define IPCT_MSG_MAX_SIZE(struct_bytes, num_elems)			\
+	(IPCT_HDR_MAX_SIZE + 2 * (struct_bytes) +			\
+	 (num_elems) * (sizeof(struct ipct_elem_std) + sizeof(uint32_t) - 1))
+
 /*
  * IPCT Tuple Set.
  *
@@ -177,13 +209,25 @@ struct ipct_action_struct_desc {
  */
 struct ipct_action_def {
 	uint32_t action_id;		/**< action ID - maps to IPC message action */
+	uint32_t flags;			/**< IPCT_ACTION_FLAG_* */
 
 	const struct ipct_action_struct_desc *desc;
 };
 
+/*
+ * Private data block action - the C structure is sent as is after the
+ * headers with hdr.block = 1 and the action tuples are not used. For legacy
+ * fixed layout ABI structures.
+ */
+#define IPCT_ACTION_FLAG_BLOCK	(1 << 0)
+
 #define IPCT_ACTION(aid, aname)							\
 		{.action_id = aid, .desc = &aname ## _action_desc}
 
+#define IPCT_ACTION_BLOCK(aid, aname)						\
+		{.action_id = aid, .flags = IPCT_ACTION_FLAG_BLOCK,		\
+		 .desc = &aname ## _action_desc}
+
 #define IPCT_DECLARE_ACTIONS(saction, ...)				\
 	const struct ipct_action_def saction ## _actions[] = {	\
 		__VA_ARGS__						\
@@ -297,4 +341,23 @@ static inline uint32_t elem_get_data_size(const struct ipct_tuple_elem *elem)
 	}
 }
 
+/* number of tuple IDs used by elem - C arrays use one per array elem */
+static inline uint32_t elem_get_count(const struct ipct_tuple_elem *elem)
+{
+	return elem->count ? elem->count : 1;
+}
+
+/* size of the C structure member in bytes - 8 bit types use 16 bit tuples */
+static inline uint32_t elem_get_c_size(const struct ipct_tuple_elem *elem)
+{
+	switch (elem->type) {
+	case ipct_type_int8_value:
+	case ipct_type_uint8_value:
+	case ipct_type_uint8_mask:
+		return sizeof(uint8_t);
+	default:
+		return elem_get_data_size(elem);
+	}
+}
+
 #endif
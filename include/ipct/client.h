@@ -23,14 +23,364 @@
 #define IPCT_FLAGS_BROADCAST	(1 << 27)
 #define IPCT_FLAGS_REPLY_NACK	(1 << 28)
 #define IPCT_FLAGS_REPLY_ACK	(1 << 29)
+#define IPCT_FLAGS_ROUTE	(1 << 30)
+
+/*
+ * Messages are routed with a route header when packed with IPCT_FLAGS_ROUTE,
+ * IPCT_FLAGS_BROADCAST or a non zero dest_addr. The sender address is the
+ * context address.
+ */
+
+struct ipct_klass_def;
+struct ipct_klass_list;
+
+/*
+ * Feature klasses linked into the client as builder_klasses are registered
+ * on first use. Other klasses can be added and removed at runtime and the
+ * pack and unpack lookups never take a lock.
+ */
+int ipct_register_klass(const struct ipct_klass_def *klass);
+int ipct_unregister_klass(uint32_t klass_id);
 
 int ipct_msg_pack(uint32_t id, void *src, size_t src_size,
 		  void *dest, size_t dest_size,
 		  uint32_t flags, uint32_t dest_addr);
 
+int ipct_msg_packed_size(uint32_t id, uint32_t flags, uint32_t dest_addr);
+
+int ipct_msg_max_size(uint32_t id);
+
 int ipct_msg_unpack(void *src, size_t src_size,
 		  void *dest, size_t dest_size,
 		  uint32_t *id, uint32_t *dest_addr);
 
+/*
+ * IPCT context.
+ *
+ * Each context has its own klass registry and statistics, e.g. one per DSP
+ * core or peer endpoint, and contexts share no state. The ipct_msg_*() API
+ * uses a default context with the builder_klasses linked into the client.
+ */
+struct ipct_context;
+
+struct ipct_ctx_stats {
+	uint64_t msgs_packed;
+	uint64_t msgs_unpacked;
+	uint64_t bytes_packed;
+	uint64_t bytes_unpacked;
+	uint64_t pack_errors;
+	uint64_t unpack_errors;
+};
+
+struct ipct_context *ipct_ctx_create(const struct ipct_klass_list *klasses);
+void ipct_ctx_free(struct ipct_context *ipct);
+struct ipct_context *ipct_ctx_default(void);
+void ipct_ctx_set_addr(struct ipct_context *ipct, uint32_t addr);
+
+int ipct_ctx_register_klass(struct ipct_context *ipct,
+			    const struct ipct_klass_def *klass);
+int ipct_ctx_unregister_klass(struct ipct_context *ipct, uint32_t klass_id);
+
+int ipct_ctx_msg_pack(struct ipct_context *ipct, uint32_t id,
+		      void *src, size_t src_size, void *dest, size_t dest_size,
+		      uint32_t flags, uint32_t dest_addr);
+
+int ipct_ctx_msg_packed_size(struct ipct_context *ipct, uint32_t id,
+			     uint32_t flags, uint32_t dest_addr);
+
+int ipct_ctx_msg_max_size(struct ipct_context *ipct, uint32_t id);
+
+int ipct_ctx_msg_unpack(struct ipct_context *ipct, void *src, size_t src_size,
+			void *dest, size_t dest_size,
+			uint32_t *id, uint32_t *dest_addr, uint32_t *flags);
+
+void ipct_ctx_get_stats(struct ipct_context *ipct,
+			struct ipct_ctx_stats *stats);
+
+/*
+ * Gather source for a top level subaction C array that is not in the action
+ * C structure. offset is the subaction member offset in the action C
+ * structure and src has the subaction array layout. The action source then
+ * only needs to hold the members that are not gathered.
+ */
+struct ipct_gather {
+	size_t offset;
+	const void *src;
+};
+
+int ipct_msg_pack_gather(uint32_t id, void *src, size_t src_size,
+			 const struct ipct_gather *gather, int count,
+			 void *dest, size_t dest_size,
+			 uint32_t flags, uint32_t dest_addr);
+int ipct_ctx_msg_pack_gather(struct ipct_context *ipct, uint32_t id,
+			     void *src, size_t src_size,
+			     const struct ipct_gather *gather, int count,
+			     void *dest, size_t dest_size,
+			     uint32_t flags, uint32_t dest_addr);
+
+/*
+ * Destination segment for scatter gather packing, e.g. the windows of a
+ * mailbox that is not contiguous in memory.
+ */
+struct ipct_iovec {
+	void *base;
+	size_t len;
+};
+
+int ipct_msg_pack_iov(uint32_t id, void *src, size_t src_size,
+		      const struct ipct_iovec *iov, int iovcnt,
+		      uint32_t flags, uint32_t dest_addr);
+int ipct_ctx_msg_pack_iov(struct ipct_context *ipct, uint32_t id,
+			  void *src, size_t src_size,
+			  const struct ipct_iovec *iov, int iovcnt,
+			  uint32_t flags, uint32_t dest_addr);
+
+/*
+ * IPCT compound messages.
+ *
+ * Actions too large for one mailbox are packed as a stream of chunks of at
+ * most chunk_size bytes. Every chunk is a message holding whole top level
+ * tuples and its elems.remaining counts down the chunks still to follow.
+ * The reassembler unpacks each chunk into the C structure as it arrives so
+ * the whole message is never buffered.
+ */
+struct ipct_msg_stream {
+	uint32_t id;				/**< message ID */
+	uint32_t flags;
+	uint32_t dest_addr;
+	size_t chunk_size;			/**< max chunk size in bytes */
+
+	/* private */
+	struct ipct_context *ipct;
+	void *src;
+	size_t src_size;
+	uint32_t offset;
+	uint32_t op;
+	uint32_t remaining;
+};
+
+int ipct_msg_stream_init(struct ipct_msg_stream *stream, uint32_t id,
+			 void *src, size_t src_size, size_t chunk_size,
+			 uint32_t flags, uint32_t dest_addr);
+int ipct_ctx_msg_stream_init(struct ipct_context *ipct,
+			     struct ipct_msg_stream *stream, uint32_t id,
+			     void *src, size_t src_size, size_t chunk_size,
+			     uint32_t flags, uint32_t dest_addr);
+int ipct_msg_stream_next(struct ipct_msg_stream *stream, void *dest,
+			 size_t dest_size);
+
+/* 64 bit words in the reassembler bitmap of received mandatory elems */
+#define IPCT_REASM_SEEN_WORDS	4
+
+struct ipct_msg_reasm {
+	uint32_t id;				/**< message ID */
+	uint32_t dest_addr;
+	uint32_t flags;
+
+	/* private */
+	struct ipct_context *ipct;
+	void *dest;
+	size_t dest_size;
+	uint32_t remaining;
+	uint32_t tuples;
+	uint64_t seen[IPCT_REASM_SEEN_WORDS];
+};
+
+int ipct_msg_reasm_init(struct ipct_msg_reasm *reasm, void *dest,
+			size_t dest_size);
+int ipct_ctx_msg_reasm_init(struct ipct_context *ipct,
+			    struct ipct_msg_reasm *reasm, void *dest,
+			    size_t dest_size);
+int ipct_msg_reasm_add(struct ipct_msg_reasm *reasm, void *src,
+		       size_t src_size);
+
+/*
+ * IPCT message batches.
+ *
+ * Independent messages, each with its own headers, packed back to back into
+ * one mailbox buffer so they are sent with a single doorbell. The receiver
+ * iterates the batch and handles each message in order.
+ */
+struct ipct_msg_batch {
+	uint32_t count;				/**< messages in batch */
+
+	/* private */
+	struct ipct_context *ipct;
+	void *buf;
+	size_t size;
+	size_t offset;
+};
+
+int ipct_msg_batch_init(struct ipct_msg_batch *batch, void *buf, size_t size);
+int ipct_ctx_msg_batch_init(struct ipct_context *ipct,
+			    struct ipct_msg_batch *batch, void *buf,
+			    size_t size);
+int ipct_msg_batch_add(struct ipct_msg_batch *batch, uint32_t id,
+		       void *src, size_t src_size,
+		       uint32_t flags, uint32_t dest_addr);
+size_t ipct_msg_batch_size(const struct ipct_msg_batch *batch);
+
+struct ipct_msg_iter {
+	/* private */
+	void *buf;
+	size_t size;
+	size_t offset;
+};
+
+void ipct_msg_iter_init(struct ipct_msg_iter *iter, void *buf, size_t size);
+int ipct_msg_iter_next(struct ipct_msg_iter *iter, void **msg,
+		       size_t *msg_size);
+
+/*
+ * IPCT message buffer pool.
+ *
+ * Message buffers in size classes sized from the largest message of each
+ * action the pool is created for. Getting and putting buffers is O(1) and
+ * lock free. Ownership moves with the buffer pointer (e.g. packer to
+ * transport to receiver) and a buffer can be referenced by several owners.
+ * The last owner puts it back from any thread.
+ */
+struct ipct_msg_pool;
+
+struct ipct_msg_pool *ipct_msg_pool_create(const uint32_t *ids, int num_ids,
+					   int bufs);
+struct ipct_msg_pool *ipct_ctx_msg_pool_create(struct ipct_context *ipct,
+					       const uint32_t *ids, int num_ids,
+					       int bufs);
+void ipct_msg_pool_destroy(struct ipct_msg_pool *pool);
+void *ipct_msg_pool_get(struct ipct_msg_pool *pool, size_t size);
+int ipct_msg_pool_ref(struct ipct_msg_pool *pool, void *data, int refs);
+int ipct_msg_pool_put(struct ipct_msg_pool *pool, void *data);
+size_t ipct_msg_pool_buf_size(struct ipct_msg_pool *pool, void *data);
+
+/*
+ * Parsed message headers - lets routers and queues dispatch a message
+ * without unpacking its body.
+ */
+struct ipct_msg_info {
+	uint32_t id;				/**< message ID */
+	uint32_t flags;				/**< IPCT_FLAGS_* */
+	uint32_t receiver;			/**< 0 if not routed */
+	uint32_t sender;			/**< 0 if not routed */
+	uint32_t num_tuples;
+	uint32_t remaining;			/**< compound chunks to follow */
+	uint32_t block;				/**< private data block */
+	uint32_t hdr_size;			/**< header size in bytes */
+	uint32_t size;				/**< body size in bytes */
+};
+
+int ipct_msg_peek(void *src, size_t src_size, struct ipct_msg_info *info);
+
+/*
+ * IPCT nano and micro messages.
+ *
+ * 32 bit header only and 64 bit header and micro tuple messages that fit in
+ * the doorbell registers, e.g. for starting and stopping events. No action
+ * lookup is done and they can't be routed. Received messages are classified
+ * by their header to pick the unpacker, micro messages set the block bit.
+ */
+#define IPCT_MSG_NANO_SIZE	4
+#define IPCT_MSG_MICRO_SIZE	8
+
+#define IPCT_MSG_CLASS_NANO	1
+#define IPCT_MSG_CLASS_MICRO	2
+#define IPCT_MSG_CLASS_STD	3
+
+int ipct_msg_pack_nano(uint32_t id, uint32_t flags, void *dest,
+		       size_t dest_size);
+int ipct_msg_pack_micro(uint32_t id, uint32_t flags, uint32_t tuple_id,
+			uint16_t value, void *dest, size_t dest_size);
+int ipct_msg_classify(void *src, size_t src_size);
+int ipct_msg_unpack_nano(void *src, size_t src_size, uint32_t *id,
+			 uint32_t *flags);
+int ipct_msg_unpack_micro(void *src, size_t src_size, uint32_t *id,
+			  uint32_t *flags, uint32_t *tuple_id, uint16_t *value);
+
+/*
+ * IPCT message relay.
+ *
+ * Forwards routed pool buffers to the port of their receiver address with
+ * only the route header rewritten in place, e.g. to bridge DSP clusters.
+ * Broadcasts are sent to every port but the sender with a buffer reference
+ * each. Receivers drop their reference with ipct_msg_pool_put().
+ */
+struct ipct_relay;
+
+struct ipct_relay_port {
+	uint32_t addr;				/**< receiver address of port */
+	uint32_t next_addr;			/**< new receiver - 0 keeps addr */
+	int (*send)(void *arg, void *msg, size_t size);
+	void *arg;
+};
+
+struct ipct_relay *ipct_relay_create(struct ipct_msg_pool *pool, uint32_t addr,
+				     const struct ipct_relay_port *ports,
+				     int num_ports);
+void ipct_relay_free(struct ipct_relay *relay);
+int ipct_relay_forward(struct ipct_relay *relay, void *msg, size_t size);
+
+/*
+ * IPCT priority receive queue.
+ *
+ * Received messages are queued by hdr.priority and high priority messages
+ * are handled first. A waiting normal priority message is handled after at
+ * most burst high priority messages. Any thread can put messages and one
+ * thread gets them, no locks are taken.
+ */
+struct ipct_msg_queue;
+
+struct ipct_msg_queue *ipct_msg_queue_create(int depth, int burst);
+void ipct_msg_queue_free(struct ipct_msg_queue *queue);
+int ipct_msg_queue_put(struct ipct_msg_queue *queue, void *msg, size_t size);
+int ipct_msg_queue_get(struct ipct_msg_queue *queue, void **msg, size_t *size);
+
+/* tuple IDs a view can index for messages not in the packed layout */
+#define IPCT_VIEW_MAX_SLOTS	64
+
+/*
+ * IPCT message view.
+ *
+ * Reads validated tuple data in place from the received message buffer
+ * instead of unpacking it into a C structure. Only top level tuples of the
+ * action can be read and the buffer must not change while the view is used.
+ */
+struct ipct_msg_view {
+	uint32_t id;				/**< message ID */
+
+	/* private */
+	const void *action;
+	const void *body;
+	const uint32_t *offsets;
+	uint32_t slot[IPCT_VIEW_MAX_SLOTS];
+};
+
+int ipct_msg_view_init(struct ipct_msg_view *view, void *src, size_t src_size);
+int ipct_ctx_msg_view_init(struct ipct_context *ipct,
+			   struct ipct_msg_view *view, void *src,
+			   size_t src_size);
+
+int ipct_view_get_u8(const struct ipct_msg_view *view, uint32_t tuple_id,
+		     uint8_t *out);
+int ipct_view_get_s8(const struct ipct_msg_view *view, uint32_t tuple_id,
+		     int8_t *out);
+int ipct_view_get_u16(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      uint16_t *out);
+int ipct_view_get_s16(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      int16_t *out);
+int ipct_view_get_u32(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      uint32_t *out);
+int ipct_view_get_s32(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      int32_t *out);
+int ipct_view_get_u64(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      uint64_t *out);
+int ipct_view_get_s64(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      int64_t *out);
+int ipct_view_get_float(const struct ipct_msg_view *view, uint32_t tuple_id,
+			float *out);
+int ipct_view_get_double(const struct ipct_msg_view *view, uint32_t tuple_id,
+			 double *out);
+int ipct_view_get_data(const struct ipct_msg_view *view, uint32_t tuple_id,
+		       const void **data, size_t *size);
+
 
 #endif /* _IPCT_CLIENT_H_ */
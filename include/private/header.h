@@ -38,9 +38,15 @@
 
 /* get headers size */
 #define IPCT_HDR_GET_HDR_SIZE(hdr) 		\
-		sizeof(struct ipct_hdr) +	\
+		(sizeof(struct ipct_hdr) +	\
 		IPCT_HDR_ELEM_ADD(hdr) +	\
-		IPCT_HDR_ROUTE_ADD(hdr)
+		IPCT_HDR_ROUTE_ADD(hdr))
+
+/* maximum headers size - header, route and elems */
+#define IPCT_HDR_MAX_SIZE			\
+		(sizeof(struct ipct_hdr) +	\
+		sizeof(struct sof_ipct_route) +	\
+		sizeof(struct sof_ipct_elems))
 
 /* get first tuple */
 #define IPCT_HDR_GET_TUPLE(hdr)			\
@@ -29,6 +29,10 @@
 #define IPC_GET_VAR_TUPLE_ARRAY(x) \
 	(struct ipct_elem_var_array *)_IPC_TO_TUPLE(x)
 
+/* tuples always start on a word boundary */
+#define IPCT_TUPLE_ALIGN(x) \
+	(((x) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+
 /*
  * Size of tuple structure and data in bytes.
  */
@@ -54,22 +58,41 @@ static inline uint32_t tuple_size(const struct ipct_tuple *tuple)
 	case IPCT_TUPLE_TYPE_TUPLE_ARRAY:
 		var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
 		return sizeof(struct ipct_elem_var_array) +
-			var->count + var->elem_bytes;
+			var->count * var->elem_bytes;
 	default:
 		return 0;
 	}
 }
 
+/*
+ * Variable and tuple arrays have a reserved word that must be 0 (ABI 2.0).
+ */
+static inline int tuple_reserved_valid(const struct ipct_tuple *tuple)
+{
+	const struct ipct_elem_var_array *var;
+
+	switch (tuple->type) {
+	case IPCT_TUPLE_TYPE_VAR_ARRAY:
+	case IPCT_TUPLE_TYPE_TUPLE_ARRAY:
+		var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+		return !var->reserved;
+	default:
+		return 1;
+	}
+}
+
 /*
  * Size of tuple data only in bytes.
  */
 static inline uint32_t tuple_data_size(const struct ipct_tuple *tuple)
 {
+	const struct ipct_elem_std *std;
 	const struct ipct_elem_var_array *var;
 
 	switch (tuple->type) {
 	case IPCT_TUPLE_TYPE_STD:
-		return sizeof(uint32_t);
+		std = IPC_GET_STD_TUPLE(tuple);
+		return std->size * sizeof(uint32_t);
 	case IPCT_TUPLE_TYPE_HD:
 		return sizeof(uint16_t);
 	case IPCT_TUPLE_TYPE_STD_ARRAY:
@@ -109,7 +132,7 @@ static inline uint32_t tuple_payload_size(const struct ipct_tuple *tuple)
 	case IPCT_TUPLE_TYPE_VAR_ARRAY:
 	case IPCT_TUPLE_TYPE_TUPLE_ARRAY:
 		var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
-		return var->count + var->elem_bytes;
+		return var->count * var->elem_bytes;
 	default:
 		return 0;
 	}
@@ -185,7 +208,7 @@ static inline int tuple_init(struct ipct_tuple *tuple,
 	struct ipct_elem_micro_array *micro_array;
 	struct ipct_elem_var_array *var;
 
-	switch (tuple->type) {
+	switch (type) {
 	case IPCT_TUPLE_TYPE_STD:
 		std = IPC_GET_STD_TUPLE(tuple);
 		std->tuple.id = id;
@@ -215,6 +238,7 @@ static inline int tuple_init(struct ipct_tuple *tuple,
 		var->tuple.id = id;
 		var->tuple.type = type;
 		var->elem_bytes = size;
+		var->reserved = 0;
 		break;
 	default:
 		return -EINVAL;
@@ -284,7 +308,7 @@ static inline int tuple_inc_elems(struct ipct_tuple *tuple)
 
 static inline const struct ipct_tuple *ipc_next_tuple(const struct ipct_tuple *current)
 {
-	return (void*)current + tuple_size(current);
+	return (void*)current + IPCT_TUPLE_ALIGN(tuple_size(current));
 }
 
 #endif /* _IPCT_PRIVATE_MESSAGE_H_ */
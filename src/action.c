@@ -0,0 +1,1078 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/* golden ratio multiplier - odd multiples are tried as index hash seeds */
+#define IPCT_INDEX_HASH_SEED	0x9E3779B1
+#define IPCT_INDEX_HASH_TRIES	64
+
+/* call func for every tuple elem in desc and its subactions */
+static int desc_for_each_elem(const struct ipct_action_struct_desc *desc,
+			      int (*func)(struct ipct_action *action,
+					  const struct ipct_action_struct_desc *desc,
+					  const struct ipct_tuple_elem *elem),
+			      struct ipct_action *action, int depth)
+{
+	int i, ret;
+
+	/* check: make sure we don't recurse too deep */
+	if (depth > IPCT_MAX_DEPTH) {
+		ipct_err("error: action descriptor too deep %d\n", depth);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < desc->mandatory.count; i++) {
+		ret = func(action, desc, &desc->mandatory.elem[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	for (i = 0; i < desc->optional.count; i++) {
+		ret = func(action, desc, &desc->optional.elem[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	for (i = 0; i < desc->subaction.count; i++) {
+		ret = desc_for_each_elem(&desc->subaction.action_desc[i], func,
+					 action, depth + 1);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* number desc and its subactions in descriptor order - counts if no table */
+static int desc_number(struct ipct_action *action,
+		       const struct ipct_action_struct_desc *desc, int depth)
+{
+	int i, ret;
+
+	/* check: make sure we don't recurse too deep */
+	if (depth > IPCT_MAX_DEPTH) {
+		ipct_err("error: action descriptor too deep %d\n", depth);
+		return -EINVAL;
+	}
+
+	if (action->descs)
+		action->descs[action->num_descs] = desc;
+	action->num_descs++;
+
+	for (i = 0; i < desc->subaction.count; i++) {
+		ret = desc_number(action, &desc->subaction.action_desc[i],
+				  depth + 1);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* build the C struct number table */
+static int action_desc_build(struct ipct_action *action)
+{
+	int ret;
+
+	ret = desc_number(action, action->def->desc, 0);
+	if (ret < 0)
+		return ret;
+
+	if (action->num_descs > IPCT_DESC_MAX) {
+		ipct_err("error: action 0x%x has too many subactions\n",
+			 action->def->action_id);
+		return -EINVAL;
+	}
+
+	action->descs = calloc(action->num_descs, sizeof(*action->descs));
+	if (!action->descs)
+		return -ENOMEM;
+
+	action->num_descs = 0;
+	return desc_number(action, action->def->desc, 0);
+}
+
+/* get the C struct number of desc */
+static int action_desc_num(const struct ipct_action *action,
+			   const struct ipct_action_struct_desc *desc)
+{
+	int i;
+
+	for (i = 0; i < action->num_descs; i++) {
+		if (action->descs[i] == desc)
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+static int elem_table_alloc(struct ipct_elem_table *elems, uint32_t num)
+{
+	elems->id = calloc(num, sizeof(*elems->id));
+	elems->count = calloc(num, sizeof(*elems->count));
+	elems->desc = calloc(num, sizeof(*elems->desc));
+	elems->mandatory = calloc(num, sizeof(*elems->mandatory));
+	elems->conv = calloc(num, sizeof(*elems->conv));
+	elems->limit = calloc(num, sizeof(*elems->limit));
+	elems->elem = calloc(num, sizeof(*elems->elem));
+	elems->num = 0;
+
+	if (!elems->id || !elems->count || !elems->desc ||
+	    !elems->mandatory || !elems->conv || !elems->limit ||
+	    !elems->elem)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void elem_table_free(struct ipct_elem_table *elems)
+{
+	free(elems->elem);
+	free(elems->limit);
+	free(elems->conv);
+	free(elems->mandatory);
+	free(elems->desc);
+	free(elems->count);
+	free(elems->id);
+}
+
+/* get the elem ID range and count */
+static int elem_scan(struct ipct_action *action,
+		     const struct ipct_action_struct_desc *desc,
+		     const struct ipct_tuple_elem *elem)
+{
+	uint32_t last = elem->id + elem_get_count(elem) - 1;
+
+	if (last > IPCT_TUPLE_MAX_ID) {
+		ipct_err("error: elem ID %d out of range\n", elem->id);
+		return -EINVAL;
+	}
+
+	if (!action->num_ids || elem->id < action->min_id)
+		action->min_id = elem->id;
+	if (!action->num_ids || last > action->max_id)
+		action->max_id = last;
+	action->num_ids += elem_get_count(elem);
+	action->elems.num++;
+
+	return 0;
+}
+
+/* add elem to the table and index - C array elems are added for every ID */
+static int elem_index(struct ipct_action *action,
+		      const struct ipct_action_struct_desc *desc,
+		      const struct ipct_tuple_elem *elem)
+{
+	struct ipct_elem_table *elems = &action->elems;
+	uint32_t n = elems->num++;
+	uint16_t *slot;
+	uint32_t i;
+
+	elems->id[n] = elem->id;
+	elems->count[n] = elem_get_count(elem);
+	elems->desc[n] = action_desc_num(action, desc);
+	elems->mandatory[n] = -1;
+	elems->elem[n] = elem;
+	codec_conv_build(&elems->conv[n], &elems->limit[n], elem);
+
+	for (i = 0; i < elem_get_count(elem); i++) {
+		slot = &action->index[action_index_slot(action, elem->id + i)];
+		if (*slot != IPCT_ELEM_NONE) {
+			ipct_err("error: duplicate elem ID %d in action 0x%x\n",
+				 elem->id + i, action->def->action_id);
+			return -EEXIST;
+		}
+
+		*slot = n;
+	}
+
+	return 0;
+}
+
+/* check elem does not collide with any other elem in the hash */
+static int elem_hash_check(struct ipct_action *action,
+			   const struct ipct_action_struct_desc *desc,
+			   const struct ipct_tuple_elem *elem)
+{
+	uint16_t *slot;
+	uint32_t i;
+
+	for (i = 0; i < elem_get_count(elem); i++) {
+		slot = &action->index[action_index_slot(action, elem->id + i)];
+		if (*slot != IPCT_ELEM_NONE)
+			return -EEXIST;
+
+		/* mark slot used - real entries are added once the seed is known */
+		*slot = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Find a collision free (perfect) multiplicative hash for sparse tuple IDs.
+ * Returns 0 and sets up the hash or -ENOENT if the dense table is no bigger.
+ */
+static int action_index_hash(struct ipct_action *action, uint32_t span)
+{
+	const struct ipct_action_struct_desc *desc = action->def->desc;
+	uint32_t bits, size, try;
+
+	/* start with a table at least twice the ID count */
+	for (bits = 1; (1 << bits) < action->num_ids * 2; bits++)
+		;
+
+	for (size = 1 << bits; size < span; size = 1 << ++bits) {
+
+		action->index = malloc(size * sizeof(*action->index));
+		if (!action->index)
+			return -ENOMEM;
+		action->index_size = size;
+		action->hash_shift = 32 - bits;
+
+		for (try = 0; try < IPCT_INDEX_HASH_TRIES; try++) {
+			action->hash_seed = IPCT_INDEX_HASH_SEED * (try * 2 + 1);
+			memset(action->index, 0xff,
+			       size * sizeof(*action->index));
+
+			if (!desc_for_each_elem(desc, elem_hash_check, action, 0)) {
+				memset(action->index, 0xff,
+				       size * sizeof(*action->index));
+				return 0;
+			}
+		}
+
+		free(action->index);
+		action->index = NULL;
+	}
+
+	/* dense table is as small as the hash table */
+	return -ENOENT;
+}
+
+/*
+ * Give each top level mandatory elem a bit in the received bitmap and build
+ * the mask of bits that must be set once a message is verified.
+ */
+static int action_mandatory_build(struct ipct_action *action)
+{
+	const struct ipct_tuple_set *mandatory = &action->def->desc->mandatory;
+	const struct ipct_tuple_elem *elem;
+	uint32_t n;
+	int i;
+
+	if (mandatory->count > IPCT_MANDATORY_MAX) {
+		ipct_err("error: action 0x%x has %d mandatory elems, max %d\n",
+			 action->def->action_id, mandatory->count,
+			 IPCT_MANDATORY_MAX);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < mandatory->count; i++) {
+		elem = &mandatory->elem[i];
+
+		n = action->index[action_index_slot(action, elem->id)];
+		action->elems.mandatory[n] = i;
+
+		action->mandatory_mask[i / 64] |= 1ULL << (i % 64);
+	}
+	action->mandatory_words = (mandatory->count + 63) / 64;
+
+	return 0;
+}
+
+/*
+ * Build the elem table and tuple ID to elem index for the action. A dense
+ * table is used when the IDs are compact and a perfect hash when they are
+ * sparse.
+ */
+static int action_index_build(struct ipct_action *action)
+{
+	const struct ipct_action_struct_desc *desc = action->def->desc;
+	uint32_t span;
+	int ret;
+
+	ret = action_desc_build(action);
+	if (ret < 0)
+		return ret;
+
+	ret = desc_for_each_elem(desc, elem_scan, action, 0);
+	if (ret < 0)
+		return ret;
+
+	if (!action->num_ids)
+		return 0;
+
+	if (action->elems.num >= IPCT_ELEM_NONE) {
+		ipct_err("error: action 0x%x has too many elems\n",
+			 action->def->action_id);
+		return -EINVAL;
+	}
+
+	span = action->max_id - action->min_id + 1;
+
+	/* sparse IDs ? */
+	if (span > action->num_ids * 2 + IPCT_INDEX_DENSE_SLACK) {
+		ret = action_index_hash(action, span);
+		if (ret == -ENOMEM)
+			return ret;
+	}
+
+	/* dense table over the used ID range */
+	if (!action->index) {
+		action->index = malloc(span * sizeof(*action->index));
+		if (!action->index)
+			return -ENOMEM;
+		memset(action->index, 0xff, span * sizeof(*action->index));
+		action->index_size = span;
+		action->hash_seed = 0;
+	}
+
+	/* elems are numbered in descriptor order */
+	ret = elem_table_alloc(&action->elems, action->elems.num);
+	if (ret < 0)
+		return ret;
+
+	ret = desc_for_each_elem(desc, elem_index, action, 0);
+	if (ret < 0)
+		return ret;
+
+	return action_mandatory_build(action);
+}
+
+static int elem_id_cmp(const void *a, const void *b)
+{
+	const struct ipct_tuple_elem *elem_a = *(const struct ipct_tuple_elem **)a;
+	const struct ipct_tuple_elem *elem_b = *(const struct ipct_tuple_elem **)b;
+
+	return elem_a->id - elem_b->id;
+}
+
+/* can elem be appended to run as the next tuple array element ? */
+static int run_is_continuous(const struct ipct_pack_run *run,
+			     const struct ipct_tuple_elem *elem,
+			     enum ipct_tuple_elem_type type, uint32_t size)
+{
+	/* must have sequential ID */
+	if (run->id + run->count != elem->id)
+		return 0;
+
+	/* must have same type and an array sized data */
+	if (run->type != type || run->data_size != size)
+		return 0;
+
+	switch (type) {
+	case IPCT_TUPLE_TYPE_STD:
+		if (size != sizeof(uint32_t))
+			return 0;
+		break;
+	case IPCT_TUPLE_TYPE_HD:
+		if (size != sizeof(uint16_t))
+			return 0;
+		break;
+	default:
+		return 0;
+	}
+
+	/* array count is 16 bits */
+	return run->count < UINT16_MAX;
+}
+
+/* can elem be packed as a C array - only numeric values are supported */
+static int elem_array_check(const struct ipct_tuple_elem *elem)
+{
+	switch (elem->type) {
+	case ipct_type_string:
+	case ipct_type_uuid:
+	case ipct_type_data:
+		ipct_err("error: elem %d type %d can't be an array\n",
+			 elem->id, elem->type);
+		return -EINVAL;
+	default:
+		break;
+	}
+
+	/* array count is 16 bits */
+	if (elem->count > UINT16_MAX) {
+		ipct_err("error: elem %d array too big %d\n",
+			 elem->id, elem->count);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* convert run to its tuple type and calculate the tuple size */
+static int run_complete(struct ipct_pack_run *run)
+{
+	uint32_t bytes;
+
+	switch (run->type) {
+	case IPCT_TUPLE_TYPE_STD:
+		if (run->count > 1 && run->data_size == sizeof(uint32_t)) {
+			run->type = IPCT_TUPLE_TYPE_STD_ARRAY;
+			bytes = sizeof(struct ipct_elem_std) +
+				run->count * sizeof(uint32_t);
+			break;
+		}
+
+		/* wider C array elems use the array elem size */
+		if (run->count > 1) {
+			run->type = IPCT_TUPLE_TYPE_VAR_ARRAY;
+			bytes = sizeof(struct ipct_elem_var_array) +
+				run->count * run->data_size;
+			break;
+		}
+
+		/* data size is in words */
+		if (IPCT_TUPLE_ALIGN(run->data_size) >> 2 > UINT16_MAX) {
+			ipct_err("error: elem id %d too big %d\n",
+				 run->id, run->data_size);
+			return -EINVAL;
+		}
+		bytes = sizeof(struct ipct_elem_std) +
+			IPCT_TUPLE_ALIGN(run->data_size);
+		break;
+	case IPCT_TUPLE_TYPE_HD:
+		if (run->count > 1) {
+			run->type = IPCT_TUPLE_TYPE_HD_ARRAY;
+			bytes = sizeof(struct ipct_elem_micro_array) +
+				run->count * sizeof(uint16_t);
+			break;
+		}
+		bytes = sizeof(struct ipct_elem_micro);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	run->bytes = IPCT_TUPLE_ALIGN(bytes);
+	return 0;
+}
+
+/*
+ * Build the pack plan for the desc elems - sort the elems by tuple ID and
+ * group continuous elems of the same type into runs that are packed as tuple
+ * arrays. Elems must be within c_size bytes of the C structure.
+ */
+static int scope_plan_build(struct ipct_pack_scope *scope, uint32_t c_size)
+{
+	const struct ipct_action_struct_desc *desc = scope->desc;
+	const struct ipct_tuple_elem *elem;
+	struct ipct_pack_run *run = NULL;
+	enum ipct_tuple_elem_type type;
+	uint32_t num_elems, size;
+	int i, ret;
+
+	num_elems = desc->mandatory.count + desc->optional.count;
+	if (!num_elems)
+		return 0;
+
+	scope->plan = calloc(num_elems, sizeof(*scope->plan));
+	scope->runs = calloc(num_elems, sizeof(*scope->runs));
+	if (!scope->plan || !scope->runs)
+		return -ENOMEM;
+
+	for (i = 0; i < desc->mandatory.count; i++)
+		scope->plan[i] = &desc->mandatory.elem[i];
+	for (i = 0; i < desc->optional.count; i++)
+		scope->plan[desc->mandatory.count + i] = &desc->optional.elem[i];
+
+	qsort(scope->plan, num_elems, sizeof(*scope->plan), elem_id_cmp);
+
+	for (i = 0; i < num_elems; i++) {
+		elem = scope->plan[i];
+
+		/* check: is elem data size valid ? */
+		size = elem_get_data_size(elem);
+		if (!size) {
+			ipct_err("error: invalid elem %d data size\n", elem->id);
+			return -EINVAL;
+		}
+
+		/* check: is elem within C structure */
+		if (elem->offset + elem_get_c_size(elem) * elem_get_count(elem) >
+		    c_size) {
+			ipct_err("error: elem %d outside structure\n", elem->id);
+			return -EINVAL;
+		}
+
+		type = ipct_get_type(elem->type);
+
+		if (elem->count) {
+			ret = elem_array_check(elem);
+			if (ret < 0)
+				return ret;
+		} else if (run && run_is_continuous(run, elem, type, size)) {
+			run->count++;
+			continue;
+		}
+
+		/* new tuple */
+		run = &scope->runs[scope->num_runs++];
+		run->id = elem->id;
+		run->type = type;
+		run->count = elem_get_count(elem);
+		run->data_size = size;
+		run->first = i;
+
+		/* C arrays are packed as their own tuple array */
+		if (elem->count)
+			run = NULL;
+	}
+
+	for (i = 0; i < scope->num_runs; i++) {
+		ret = run_complete(&scope->runs[i]);
+		if (ret < 0)
+			return ret;
+		scope->bytes += scope->runs[i].bytes;
+
+		/* variable arrays have two header words to check */
+		scope->num_checks++;
+		if (scope->runs[i].type == IPCT_TUPLE_TYPE_VAR_ARRAY)
+			scope->num_checks++;
+	}
+
+	scope->num_ops = num_elems;
+	scope->key = scope->runs[0].id;
+	return 0;
+}
+
+/*
+ * Build the pack plan for desc and its subactions. Each subaction array is
+ * split into count elements of stride bytes using the subaction size.
+ */
+static int scope_build(const struct ipct_action *action,
+		       struct ipct_pack_scope *scope,
+		       const struct ipct_action_struct_desc *desc,
+		       uint32_t c_size, int depth)
+{
+	const struct ipct_action_struct_desc *sub;
+	struct ipct_pack_scope *child;
+	uint64_t bytes;
+	int i, ret;
+
+	/* check: make sure we don't recurse too deep */
+	if (depth > IPCT_MAX_DEPTH) {
+		ipct_err("error: action descriptor too deep %d\n", depth);
+		return -EINVAL;
+	}
+
+	scope->desc = desc;
+	scope->desc_num = action_desc_num(action, desc);
+	scope->key = IPCT_TUPLE_MAX_ID;
+
+	ret = scope_plan_build(scope, c_size);
+	if (ret < 0)
+		return ret;
+
+	if (!desc->subaction.count)
+		return 0;
+
+	scope->child = calloc(desc->subaction.count, sizeof(*scope->child));
+	if (!scope->child)
+		return -ENOMEM;
+	scope->num_children = desc->subaction.count;
+
+	for (i = 0; i < desc->subaction.count; i++) {
+		sub = &desc->subaction.action_desc[i];
+		child = &scope->child[i];
+
+		/* array_elems is 0 for a single child struct */
+		child->count = sub->array_elems ? sub->array_elems : 1;
+		if (sub->array_elems < 0 || sub->array_elems > UINT16_MAX ||
+		    !sub->size || sub->size % child->count ||
+		    sub->offset + sub->size > c_size) {
+			ipct_err("error: subaction at offset %ld outside structure\n",
+				 sub->offset);
+			return -EINVAL;
+		}
+		child->offset = sub->offset;
+		child->stride = sub->size / child->count;
+
+		ret = scope_build(action, child, sub, child->stride, depth + 1);
+		if (ret < 0)
+			return ret;
+
+		if (!child->num_ops) {
+			ipct_err("error: subaction at offset %ld has no elems\n",
+				 sub->offset);
+			return -EINVAL;
+		}
+
+		/* array elem size is 16 bits */
+		bytes = scope->bytes + sizeof(struct ipct_elem_var_array) +
+			(uint64_t)child->count * child->bytes;
+		if (child->bytes > UINT16_MAX || bytes > IPCT_BODY_MAX_BYTES) {
+			ipct_err("error: subaction at offset %ld too big\n",
+				 sub->offset);
+			return -EINVAL;
+		}
+
+		scope->bytes = bytes;
+		scope->num_ops += child->count * child->num_ops;
+		scope->num_checks += 2 + child->count * child->num_checks;
+		if (child->key < scope->key)
+			scope->key = child->key;
+	}
+
+	return 0;
+}
+
+static void scope_free(struct ipct_pack_scope *scope)
+{
+	int i;
+
+	for (i = 0; i < scope->num_children; i++)
+		scope_free(&scope->child[i]);
+
+	free(scope->child);
+	free(scope->runs);
+	free(scope->plan);
+}
+
+/* build the pack plan for the action C structure */
+static int action_plan_build(struct ipct_action *action)
+{
+	const struct ipct_action_struct_desc *desc = action->def->desc;
+	int ret;
+
+	ret = scope_build(action, &action->scope, desc, desc->size, 0);
+	if (ret < 0)
+		return ret;
+
+	action->num_tuples = action->scope.num_runs + action->scope.num_children;
+	action->plan_bytes = action->scope.bytes;
+	return 0;
+}
+
+/* set the unpack value check for elem - limits are cast to the elem type */
+void elem_op_check(const struct ipct_tuple_elem *elem,
+		   struct ipct_codec_op *op)
+{
+	switch (elem->type) {
+	case ipct_type_uint8_value:
+		op->check = IPCT_CHECK_UINT;
+		op->min.u = (uint8_t)elem->value1;
+		op->max.u = (uint8_t)elem->value2;
+		break;
+	case ipct_type_int8_value:
+		op->check = IPCT_CHECK_INT;
+		op->min.i = (int8_t)elem->value1;
+		op->max.i = (int8_t)elem->value2;
+		break;
+	case ipct_type_uint16_value:
+	case ipct_type_boolean:
+		op->check = IPCT_CHECK_UINT;
+		op->min.u = (uint16_t)elem->value1;
+		op->max.u = (uint16_t)elem->value2;
+		break;
+	case ipct_type_int16_value:
+		op->check = IPCT_CHECK_INT;
+		op->min.i = (int16_t)elem->value1;
+		op->max.i = (int16_t)elem->value2;
+		break;
+	case ipct_type_uint32_value:
+	case ipct_type_enum:
+		op->check = IPCT_CHECK_UINT;
+		op->min.u = (uint32_t)elem->value1;
+		op->max.u = (uint32_t)elem->value2;
+		break;
+	case ipct_type_int32_value:
+		op->check = IPCT_CHECK_INT;
+		op->min.i = (int32_t)elem->value1;
+		op->max.i = (int32_t)elem->value2;
+		break;
+	case ipct_type_uint64_value:
+		op->check = IPCT_CHECK_UINT;
+		op->min.u = (uint64_t)elem->value1;
+		op->max.u = (uint64_t)elem->value2;
+		break;
+	case ipct_type_int64_value:
+		op->check = IPCT_CHECK_INT;
+		op->min.i = (int64_t)elem->value1;
+		op->max.i = (int64_t)elem->value2;
+		break;
+	case ipct_type_float_value:
+		op->check = IPCT_CHECK_FLOAT;
+		op->min.d = (float)elem->value1;
+		op->max.d = (float)elem->value2;
+		break;
+	case ipct_type_double_value:
+		op->check = IPCT_CHECK_DOUBLE;
+		op->min.d = (double)elem->value1;
+		op->max.d = (double)elem->value2;
+		break;
+	case ipct_type_uint8_mask:
+		op->check = IPCT_CHECK_MASK;
+		op->max.u = (uint8_t)elem->value1;
+		break;
+	case ipct_type_uint16_mask:
+		op->check = IPCT_CHECK_MASK;
+		op->max.u = (uint16_t)elem->value1;
+		break;
+	case ipct_type_uint32_mask:
+		op->check = IPCT_CHECK_MASK;
+		op->max.u = (uint32_t)elem->value1;
+		break;
+	case ipct_type_uint64_mask:
+		op->check = IPCT_CHECK_MASK;
+		op->max.u = (uint64_t)elem->value1;
+		break;
+	default:
+		op->check = IPCT_CHECK_NONE;
+		break;
+	}
+}
+
+/* append op - merging with the previous op when both layouts line up */
+static void op_add(struct ipct_codec_op *ops, uint32_t *num_ops,
+		   const struct ipct_codec_op *op)
+{
+	struct ipct_codec_op *prev = *num_ops ? &ops[*num_ops - 1] : NULL;
+
+	if (prev && prev->type == op->type &&
+	    (op->type == IPCT_OP_COPY || op->type == IPCT_OP_ZERO) &&
+	    !prev->check && !op->check &&
+	    prev->c_offset + prev->bytes == op->c_offset &&
+	    (op->type == IPCT_OP_ZERO ||
+	     prev->wire_offset + prev->bytes == op->wire_offset)) {
+		prev->bytes += op->bytes;
+		return;
+	}
+
+	ops[(*num_ops)++] = *op;
+}
+
+/*
+ * Add the pack and unpack ops for elem with data at wire_offset in body. C
+ * arrays are a single op covering every array elem.
+ */
+static int elem_ops_build(struct ipct_action *action,
+			  const struct ipct_tuple_elem *elem, uint32_t c_base,
+			  uint32_t wire_offset, uint32_t data_size)
+{
+	struct ipct_codec_op op = {
+		.type		= IPCT_OP_COPY,
+		.id		= elem->id,
+		.size		= data_size,
+		.bytes		= data_size * elem_get_count(elem),
+		.c_offset	= c_base + elem->offset,
+		.wire_offset	= wire_offset,
+	};
+
+	switch (elem->type) {
+	case ipct_type_uint8_value:
+	case ipct_type_uint8_mask:
+		op.type = IPCT_OP_UINT8;
+		break;
+	case ipct_type_int8_value:
+		op.type = IPCT_OP_INT8;
+		break;
+	default:
+		break;
+	}
+
+	op_add(action->pack_ops, &action->num_pack_ops, &op);
+
+	/* strings and data copy value1 bytes and zero the rest of the member */
+	if (elem->type == ipct_type_string || elem->type == ipct_type_data) {
+		if (elem->value1 > data_size) {
+			ipct_err("error: elem %d length %ld exceeds size %d\n",
+				 elem->id, elem->value1, data_size);
+			return -EINVAL;
+		}
+
+		op.bytes = elem->value1;
+		if (op.bytes)
+			op_add(action->unpack_ops, &action->num_unpack_ops, &op);
+
+		op.type = IPCT_OP_ZERO;
+		op.c_offset += op.bytes;
+		op.bytes = data_size - op.bytes;
+		if (op.bytes)
+			op_add(action->unpack_ops, &action->num_unpack_ops, &op);
+		return 0;
+	}
+
+	elem_op_check(elem, &op);
+	op_add(action->unpack_ops, &action->num_unpack_ops, &op);
+	return 0;
+}
+
+/* add a check for the tuple header word at offset in the template */
+static void tuple_check_add(struct ipct_action *action, uint32_t offset,
+			    uint32_t mask)
+{
+	struct ipct_tuple_check *check;
+
+	check = &action->tuple_checks[action->num_checks++];
+	check->offset = offset;
+	check->mask = mask;
+	memcpy(&check->value, action->template + offset, sizeof(check->value));
+	check->value &= mask;
+}
+
+/*
+ * Lower the scope pack plan into codec ops for the C struct at c_base and
+ * write its tuple headers to the template at offset. Subaction arrays are
+ * lowered once for every array element.
+ */
+static int scope_codec_build(struct ipct_action *action,
+			     const struct ipct_pack_scope *scope,
+			     uint32_t c_base, uint32_t offset)
+{
+	const struct ipct_pack_scope *child;
+	const struct ipct_pack_run *run;
+	struct ipct_elem_var_array *var;
+	struct ipct_tuple *tuple;
+	uint32_t data_offset, mask, elems;
+	int i, j, ret;
+
+	for (i = 0; i < scope->num_runs; i++) {
+		run = &scope->runs[i];
+		tuple = action->template + offset;
+
+		/*
+		 * arrays are sized by elem count, standard tuples by data size
+		 * and variable arrays by elem size.
+		 */
+		if (run->type == IPCT_TUPLE_TYPE_STD)
+			tuple_init(tuple, run->type, run->id,
+				   IPCT_TUPLE_ALIGN(run->data_size));
+		else if (run->type == IPCT_TUPLE_TYPE_VAR_ARRAY) {
+			tuple_init(tuple, run->type, run->id, run->data_size);
+			var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+			var->count = run->count;
+		} else
+			tuple_init(tuple, run->type, run->id, run->count);
+
+		/* micro tuple data shares the header word */
+		if (run->type == IPCT_TUPLE_TYPE_HD) {
+			mask = 0;
+			memset(&mask, 0xff, sizeof(struct ipct_tuple));
+		} else {
+			mask = UINT32_MAX;
+		}
+		tuple_check_add(action, offset, mask);
+
+		/* variable arrays have a second header word */
+		if (run->type == IPCT_TUPLE_TYPE_VAR_ARRAY)
+			tuple_check_add(action, offset + sizeof(uint32_t),
+					UINT32_MAX);
+
+		/* C array elems are the whole run */
+		data_offset = offset + (tuple_get_data(tuple, 0) - (void *)tuple);
+		elems = scope->plan[run->first]->count ? 1 : run->count;
+		for (j = 0; j < elems; j++) {
+			ret = elem_ops_build(action, scope->plan[run->first + j],
+					     c_base,
+					     data_offset + j * run->data_size,
+					     run->data_size);
+			if (ret < 0)
+				return ret;
+		}
+
+		offset += run->bytes;
+	}
+
+	for (i = 0; i < scope->num_children; i++) {
+		child = &scope->child[i];
+		var = action->template + offset;
+
+		/* top level subaction ops can be packed from another source */
+		if (scope == &action->scope)
+			action->scope.child[i].pack_op = action->num_pack_ops;
+
+		tuple_init(&var->tuple, IPCT_TUPLE_TYPE_TUPLE_ARRAY, child->key,
+			   child->bytes);
+		var->count = child->count;
+		tuple_check_add(action, offset, UINT32_MAX);
+		tuple_check_add(action, offset + sizeof(uint32_t), UINT32_MAX);
+		offset += sizeof(*var);
+
+		for (j = 0; j < child->count; j++) {
+			ret = scope_codec_build(action, child,
+						c_base + child->offset +
+						j * child->stride, offset);
+			if (ret < 0)
+				return ret;
+			offset += child->bytes;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Lower the pack plan into codec ops and build the body template holding
+ * every tuple header so packing only needs to copy the data.
+ */
+static int action_codec_build(struct ipct_action *action)
+{
+	const struct ipct_pack_scope *scope = &action->scope;
+	const struct ipct_codec_op *op;
+	uint32_t i, last, c_bytes;
+	int ret;
+
+	if (!scope->num_ops)
+		return 0;
+
+	action->template = calloc(1, action->plan_bytes);
+	action->tuple_checks = calloc(scope->num_checks,
+				      sizeof(*action->tuple_checks));
+	action->pack_ops = calloc(scope->num_ops, sizeof(*action->pack_ops));
+	action->unpack_ops = calloc(scope->num_ops * 2,
+				    sizeof(*action->unpack_ops));
+	if (!action->template || !action->tuple_checks ||
+	    !action->pack_ops || !action->unpack_ops)
+		return -ENOMEM;
+
+	ret = scope_codec_build(action, scope, 0, 0);
+	if (ret < 0)
+		return ret;
+
+	/* top level elems are packed before any subaction */
+	last = scope->num_children ? scope->child[0].pack_op :
+		action->num_pack_ops;
+	for (i = 0; i < last; i++) {
+		op = &action->pack_ops[i];
+
+		/* 8 bit C data uses 16 bit tuple data */
+		c_bytes = op->type == IPCT_OP_COPY ? op->bytes :
+			op->bytes / sizeof(uint16_t);
+		if (op->c_offset + c_bytes > action->src_bytes)
+			action->src_bytes = op->c_offset + c_bytes;
+	}
+
+	return 0;
+}
+
+/*
+ * Build the packed body data offset of every top level tuple ID so message
+ * views of packed layout messages need no per message offset table.
+ */
+static int action_view_build(struct ipct_action *action)
+{
+	const struct ipct_pack_scope *scope = &action->scope;
+	const struct ipct_tuple_elem *elem;
+	const struct ipct_pack_run *run;
+	const struct ipct_tuple *tuple;
+	uint32_t offset = 0, data_offset, slot;
+	int i, j;
+
+	if (!action->index_size)
+		return 0;
+
+	action->view_offsets = malloc(action->index_size *
+				      sizeof(*action->view_offsets));
+	if (!action->view_offsets)
+		return -ENOMEM;
+	memset(action->view_offsets, 0xff,
+	       action->index_size * sizeof(*action->view_offsets));
+
+	/* run elems and C array elems are stored in tuple ID order */
+	for (i = 0; i < scope->num_runs; i++) {
+		run = &scope->runs[i];
+		elem = scope->plan[run->first];
+		tuple = action->template + offset;
+		data_offset = offset + (tuple_get_data(tuple, 0) - (void *)tuple);
+
+		for (j = 0; j < run->count; j++) {
+			slot = action_index_slot(action, elem->id + j);
+			action->view_offsets[slot] = data_offset +
+						     j * run->data_size;
+		}
+
+		offset += run->bytes;
+	}
+
+	return 0;
+}
+
+/**
+ * Compile an action definition into its runtime lookup data.
+ */
+struct ipct_action *action_build(const struct ipct_action_def *def)
+{
+	struct ipct_action *action;
+	int ret;
+
+	action = calloc(1, sizeof(*action));
+	if (!action)
+		return NULL;
+	action->def = def;
+
+	/* private data blocks are copied as is - no tuples are used */
+	if (def->flags & IPCT_ACTION_FLAG_BLOCK) {
+		action->src_bytes = def->desc->size;
+		action->plan_bytes = IPCT_TUPLE_ALIGN(def->desc->size);
+		if (action->plan_bytes > IPCT_BODY_MAX_BYTES) {
+			ipct_err("error: block action 0x%x too big\n",
+				 def->action_id);
+			action_free(action);
+			return NULL;
+		}
+		return action;
+	}
+
+	ret = action_index_build(action);
+	if (ret < 0) {
+		ipct_err("error: can't build index for action 0x%x: %d\n",
+			 def->action_id, ret);
+		action_free(action);
+		return NULL;
+	}
+
+	ret = action_plan_build(action);
+	if (ret < 0) {
+		ipct_err("error: can't build pack plan for action 0x%x: %d\n",
+			 def->action_id, ret);
+		action_free(action);
+		return NULL;
+	}
+
+	ret = action_codec_build(action);
+	if (ret < 0) {
+		ipct_err("error: can't build codec for action 0x%x: %d\n",
+			 def->action_id, ret);
+		action_free(action);
+		return NULL;
+	}
+
+	ret = action_view_build(action);
+	if (ret < 0) {
+		ipct_err("error: can't build view for action 0x%x: %d\n",
+			 def->action_id, ret);
+		action_free(action);
+		return NULL;
+	}
+
+	return action;
+}
+
+void action_free(struct ipct_action *action)
+{
+	free(action->view_offsets);
+	free(action->unpack_ops);
+	free(action->pack_ops);
+	free(action->tuple_checks);
+	free(action->template);
+	scope_free(&action->scope);
+	free(action->index);
+	elem_table_free(&action->elems);
+	free(action->descs);
+	free(action);
+}
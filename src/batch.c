@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Message batches - several independent messages, each with its own headers,
+ * are packed back to back into one mailbox buffer and sent with a single
+ * doorbell. The receiver walks the batch in order using the message sizes
+ * from the headers.
+ */
+
+/** \brief
+ *  Start a batch of messages packed with context ipct into buffer buf.
+ */
+int ipct_ctx_msg_batch_init(struct ipct_context *ipct,
+			    struct ipct_msg_batch *batch, void *buf,
+			    size_t size)
+{
+	batch->ipct = ipct;
+	batch->buf = buf;
+	batch->size = size;
+	batch->offset = 0;
+	batch->count = 0;
+
+	return 0;
+}
+
+/** \brief
+ *  Pack a message from source C structure and append it to the batch.
+ *  Returns the message size in bytes, -ENOSPC if the batch is full or
+ *  another negative error code. The batch is unchanged on error so a full
+ *  batch can be sent and the message added to a new one.
+ */
+int ipct_msg_batch_add(struct ipct_msg_batch *batch, uint32_t id,
+		       void *src, size_t src_size,
+		       uint32_t flags, uint32_t dest_addr)
+{
+	int ret;
+
+	/* nothing is written if the message doesn't fit */
+	ret = ipct_ctx_msg_pack(batch->ipct, id, src, src_size,
+				batch->buf + batch->offset,
+				batch->size - batch->offset, flags, dest_addr);
+	if (ret < 0)
+		return ret;
+
+	batch->offset += ret;
+	batch->count++;
+	return ret;
+}
+
+/** \brief
+ *  Get the size in bytes of all messages in the batch.
+ */
+size_t ipct_msg_batch_size(const struct ipct_msg_batch *batch)
+{
+	return batch->offset;
+}
+
+/** \brief
+ *  Start iterating the messages of a received batch of size bytes.
+ */
+void ipct_msg_iter_init(struct ipct_msg_iter *iter, void *buf, size_t size)
+{
+	iter->buf = buf;
+	iter->size = size;
+	iter->offset = 0;
+}
+
+/** \brief
+ *  Get the next message of the batch. Messages without elems are sized as
+ *  nano or micro messages like ipct_msg_peek(). Returns 1 with the message
+ *  and its size, 0 at the end of the batch or a negative error code if the
+ *  batch is malformed.
+ */
+int ipct_msg_iter_next(struct ipct_msg_iter *iter, void **msg,
+		       size_t *msg_size)
+{
+	struct ipct_hdr *hdr = iter->buf + iter->offset;
+	size_t avail = iter->size - iter->offset;
+	size_t size;
+
+	if (!avail)
+		return 0;
+
+	/* check: headers are in the batch */
+	if (avail < sizeof(*hdr) || IPCT_HDR_GET_HDR_SIZE(hdr) > avail) {
+		ipct_err("ipct: error batch headers at %zu exceed batch\n",
+			 iter->offset);
+		return -EINVAL;
+	}
+
+	if (hdr->elems)
+		size = IPCT_HDR_GET_HDR_SIZE(hdr) + ipct_get_size(hdr);
+	else
+		size = msg_micro_size(hdr);
+	if (size > avail) {
+		ipct_err("ipct: error batch message at %zu size %zu exceeds batch\n",
+			 iter->offset, size);
+		return -EINVAL;
+	}
+
+	*msg = hdr;
+	*msg_size = size;
+	iter->offset += size;
+	return 1;
+}
@@ -15,178 +15,187 @@
 #include <ipct/builder.h>
 #include "priv.h"
 
-/* IPCT klasses */
+/* IPCT klasses linked into the client - can be empty */
 static const struct ipct_klass_list *features = &builder_klasses;
 
-const struct ipct_action_def *get_action(const struct ipct_subklass_def *subklass,
-						uint32_t id)
+enum context_state {
+	CONTEXT_NONE = 0,
+	CONTEXT_INIT,
+	CONTEXT_READY,
+};
+
+/* default context used by the ipct_msg_*() API - features added on first use */
+static struct ipct_context context;
+static atomic_int context_state;
+
+static struct ipct_context *default_context(void)
 {
-	const struct ipct_action_def *action;
-	uint32_t id_action = IPCT_ID_GET_ACTION(id);
-	int i;
-
-	/* iterate all actions for matching ID */
-	for (i = 0; i < subklass->num_actions; i++) {
-		action = &subklass->actions[i];
-		if (id_action == action->action_id)
-			return action;
+	int state = CONTEXT_NONE;
+
+	if (atomic_load_explicit(&context_state, memory_order_acquire) ==
+	    CONTEXT_READY)
+		return &context;
+
+	if (atomic_compare_exchange_strong(&context_state, &state,
+					   CONTEXT_INIT)) {
+		context_init(&context);
+		if (registry_add_list(&context.registry, features) < 0)
+			ipct_err("error: can't register linked klasses\n");
+		atomic_store_explicit(&context_state, CONTEXT_READY,
+				      memory_order_release);
 	}
 
-	/* not found */
-	ipct_err("error: can't find action 0x%x from ID 0x%x\n",
-		id_action, id);
-	return NULL;
+	/* another thread is adding the linked klasses */
+	while (atomic_load_explicit(&context_state, memory_order_acquire) !=
+	       CONTEXT_READY)
+		;
+
+	return &context;
 }
 
-const struct ipct_subklass_def *get_subklass(const struct ipct_klass_def *klass,
-						    uint32_t id)
+/** \brief
+ *  Get the default context used by the ipct_msg_*() API.
+ */
+struct ipct_context *ipct_ctx_default(void)
 {
-	const struct ipct_subklass_def *subklass;
-	uint32_t id_subklass = IPCT_ID_GET_SUBKLASS(id);
-	int i;
-
-	/* iterate all subklasses for matching ID */
-	for (i = 0; i < klass->num_subklasses; i++) {
-		subklass = &klass->subklass[i];
-		if (id_subklass == subklass->subclass_id)
-			return subklass;
-	}
-
-	/* not found */
-	ipct_err("error: can't find subklass 0x%x from ID 0x%x\n",
-		id_subklass, id);
-	return NULL;
+	return default_context();
 }
 
-const struct ipct_klass_def *get_klass(uint32_t id)
+/** \brief
+ *  Register a feature klass at runtime. The klass definition must stay valid
+ *  until it's unregistered.
+ */
+int ipct_register_klass(const struct ipct_klass_def *klass)
 {
-	const struct ipct_klass_def *klass;
-	uint32_t id_klass = IPCT_ID_GET_KLASS(id);
-	int i;
-
-	/* iterate all klasses for matching ID */
-	for (i = 0; i <features->num_klasses; i++) {
-		klass = &features->klasses[i];
-		if (id_klass == klass->klass_id)
-			return klass;
-	}
+	return ipct_ctx_register_klass(default_context(), klass);
+}
 
-	/* not found */
-	ipct_err("error: can't find klass 0x%x from ID 0x%x\n",
-		id_klass, id);
-	return NULL;
+/** \brief
+ *  Unregister a feature klass. Waits for any pack, unpack or view init using
+ *  the klass to finish. Views of its messages must not be used afterwards.
+ */
+int ipct_unregister_klass(uint32_t klass_id)
+{
+	return ipct_ctx_unregister_klass(default_context(), klass_id);
 }
 
-const struct ipct_action_def *get_action_def(uint32_t id)
+/** \brief
+ *  Create an IPCT style message from source C structure and pack into
+ *  destination buffer. Returns the size in bytes, -ENOSPC if it doesn't fit
+ *  in dest or a negative error code.
+ */
+int ipct_msg_pack(uint32_t id, void *src, size_t src_size,
+		  void *dest, size_t dest_size,
+		  uint32_t flags, uint32_t dest_addr)
 {
-	const struct ipct_subklass_def *subklass;
-	const struct ipct_klass_def *klass;
+	return ipct_ctx_msg_pack(default_context(), id, src, src_size,
+				 dest, dest_size, flags, dest_addr);
+}
 
-	klass = get_klass(id);
-	if (!klass)
-		return NULL;
+/** \brief
+ *  Create an IPCT style message from source C structure and the gathered
+ *  subaction C arrays and pack into destination buffer.
+ */
+int ipct_msg_pack_gather(uint32_t id, void *src, size_t src_size,
+			 const struct ipct_gather *gather, int count,
+			 void *dest, size_t dest_size,
+			 uint32_t flags, uint32_t dest_addr)
+{
+	return ipct_ctx_msg_pack_gather(default_context(), id, src, src_size,
+					gather, count, dest, dest_size, flags,
+					dest_addr);
+}
 
-	subklass = get_subklass(klass, id);
-	if (!subklass)
-		return NULL;
+/** \brief
+ *  Create an IPCT style message from source C structure and pack it straight
+ *  into the iovcnt destination segments in iov. Returns the message size,
+ *  -ENOSPC if it doesn't fit in the segments or a negative error code.
+ */
+int ipct_msg_pack_iov(uint32_t id, void *src, size_t src_size,
+		      const struct ipct_iovec *iov, int iovcnt,
+		      uint32_t flags, uint32_t dest_addr)
+{
+	return ipct_ctx_msg_pack_iov(default_context(), id, src, src_size,
+				     iov, iovcnt, flags, dest_addr);
+}
 
-	return get_action(subklass, id);
+/** \brief
+ *  Get the exact size in bytes of the message ipct_msg_pack() creates for
+ *  action ID with the same flags and dest_addr. Returns the size or a
+ *  negative error code.
+ */
+int ipct_msg_packed_size(uint32_t id, uint32_t flags, uint32_t dest_addr)
+{
+	return ipct_ctx_msg_packed_size(default_context(), id, flags,
+					dest_addr);
 }
 
-const struct ipct_tuple_elem *get_tuple_elem(const struct ipct_action_struct_desc *desc,
-					     const struct ipct_tuple *tuple, int index,
-					     int depth)
+/** \brief
+ *  Get the worst case size in bytes of any message for action ID.
+ *  Returns the size or a negative error code.
+ */
+int ipct_msg_max_size(uint32_t id)
 {
-	const struct ipct_action_struct_desc *subaction;
-	const struct ipct_tuple_elem *elem;
-	int i;
-
-	/* check mandatory first */
-	for (i = 0; i < desc->mandatory.count; i++) {
-		elem = &desc->mandatory.elem[i];
-		if (elem->id == tuple->id + index)
-			return elem;
-	}
+	return ipct_ctx_msg_max_size(default_context(), id);
+}
 
-	/* check optional next */
-	for (i = 0; i < desc->optional.count; i++) {
-		elem = &desc->optional.elem[i];
-		if (elem->id == tuple->id + index)
-			return elem;
-	}
+/** \brief
+ *  received IPCT message
+ */
+int ipct_msg_unpack(void *src, size_t src_size,
+		  void *dest, size_t dest_size,
+		  uint32_t *id, uint32_t *dest_addr)
+{
+	return ipct_ctx_msg_unpack(default_context(), src, src_size,
+				   dest, dest_size, id, dest_addr, NULL);
+}
 
-	/* not found ? - check sub structures */
-	for (i = 0; i < desc->subaction.count; i++) {
-		subaction = &desc->subaction.action_desc[i];
-		elem = get_tuple_elem(subaction, tuple, index, depth + 1);
-	}
+/** \brief
+ *  Create a view of received IPCT message in src. The message is validated
+ *  and must not change while the view is used.
+ */
+int ipct_msg_view_init(struct ipct_msg_view *view, void *src, size_t src_size)
+{
+	return ipct_ctx_msg_view_init(default_context(), view, src, src_size);
+}
 
-	/* cannot find elem */
-	return NULL;
+/** \brief
+ *  Start packing action ID from source C structure as a compound message of
+ *  chunks of at most chunk_size bytes. Returns the number of chunks, -ENOSPC
+ *  if a tuple doesn't fit in one chunk or a negative error code.
+ */
+int ipct_msg_stream_init(struct ipct_msg_stream *stream, uint32_t id,
+			 void *src, size_t src_size, size_t chunk_size,
+			 uint32_t flags, uint32_t dest_addr)
+{
+	return ipct_ctx_msg_stream_init(default_context(), stream, id, src,
+					src_size, chunk_size, flags, dest_addr);
 }
 
+/** \brief
+ *  Start reassembling received compound messages into C structure dest.
+ */
+int ipct_msg_reasm_init(struct ipct_msg_reasm *reasm, void *dest,
+			size_t dest_size)
+{
+	return ipct_ctx_msg_reasm_init(default_context(), reasm, dest,
+				       dest_size);
+}
 
 /** \brief
- *  Create an IPCT style message from source C structure and pack into
- *  destination buffer.
+ *  Start a batch of messages packed into buffer buf.
  */
-int ipct_msg_pack(uint32_t id, void *src, size_t src_size,
-		  void *dest, size_t dest_size,
-		  uint32_t flags, uint32_t dest_addr)
+int ipct_msg_batch_init(struct ipct_msg_batch *batch, void *buf, size_t size)
 {
-	struct ipct_msg_context msg;
-	int ret;
-
-	/* setup context */
-	msg.id = id;
-	msg.addr = dest_addr;
-	msg.flags = flags;
-	msg.src.base = src;
-	msg.src.offset = 0;
-	msg.src.size = src_size;
-	msg.dest.base = dest;
-	msg.dest.offset = 0;
-	msg.dest.size = dest_size;
-
-	/* now pack the data */
-	ret = ipct_pack(&msg);
-	if (ret < 0)
-		ipct_err("ipct: error failed to pack object 0x%x\n", id);
-
-	return ret;
+	return ipct_ctx_msg_batch_init(default_context(), batch, buf, size);
 }
 
 /** \brief
- *  received IPCT message
+ *  Create a pool with bufs buffers of each size class used by the largest
+ *  messages of the num_ids action IDs in ids.
  */
-int ipct_msg_unpack(void *src, size_t src_size,
-		  void *dest, size_t dest_size,
-		  uint32_t *id, uint32_t *dest_addr)
+struct ipct_msg_pool *ipct_msg_pool_create(const uint32_t *ids, int num_ids,
+					   int bufs)
 {
-	struct ipct_msg_context msg;
-	int ret;
-
-	/* setup context */
-	msg.id = 0;
-	msg.addr = 0;
-	msg.flags = 0;
-	msg.src.base = src;
-	msg.src.offset = 0;
-	msg.src.size = src_size;
-	msg.dest.base = dest;
-	msg.dest.offset = 0;
-	msg.dest.size = dest_size;
-
-
-	ret = ipct_unpack(&msg);
-	if (ret < 0)
-		return ret;
-
-	/* assign id and address if requested */
-	if (id)
-		*id = msg.id;
-	if (dest_addr)
-		*dest_addr = msg.addr;
-
-	return 0;
+	return ipct_ctx_msg_pool_create(default_context(), ids, num_ids, bufs);
 }
@@ -0,0 +1,464 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Codec op loops - run the ops compiled from the action descriptor. No
+ * descriptor data is used here.
+ */
+
+/*
+ * 8 bit C data uses 16 bit tuple data. The loops are kept simple so the
+ * compiler can vectorize them for large C arrays.
+ */
+static void codec_widen_u8(void *wire, const uint8_t *c, uint32_t count)
+{
+	uint16_t u16;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		u16 = c[i];
+		memcpy(wire + i * sizeof(u16), &u16, sizeof(u16));
+	}
+}
+
+static void codec_widen_s8(void *wire, const int8_t *c, uint32_t count)
+{
+	int16_t s16;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		s16 = c[i];
+		memcpy(wire + i * sizeof(s16), &s16, sizeof(s16));
+	}
+}
+
+static void codec_narrow_8(uint8_t *c, const void *wire, uint32_t count)
+{
+	uint16_t u16;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		memcpy(&u16, wire + i * sizeof(u16), sizeof(u16));
+		c[i] = u16;
+	}
+}
+
+/* run the pack ops for the body bytes at base onwards in body */
+static void codec_pack_ops(const struct ipct_codec_op *op,
+			   const struct ipct_codec_op *end, void *body,
+			   uint32_t base, const void *src)
+{
+	void *wire;
+
+	for (; op < end; op++) {
+		wire = body + op->wire_offset - base;
+
+		switch (op->type) {
+		case IPCT_OP_COPY:
+			memcpy(wire, src + op->c_offset, op->bytes);
+			break;
+		case IPCT_OP_UINT8:
+			codec_widen_u8(wire, src + op->c_offset,
+				       op->bytes / sizeof(uint16_t));
+			break;
+		case IPCT_OP_INT8:
+			codec_widen_s8(wire, src + op->c_offset,
+				       op->bytes / sizeof(uint16_t));
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/**
+ * Pack C structure src into message body using the compiled pack ops.
+ * Caller has checked body is large enough for action->plan_bytes.
+ */
+void codec_pack(const struct ipct_action *action, void *body, const void *src)
+{
+	/* tuple headers and padding */
+	memcpy(body, action->template, action->plan_bytes);
+
+	codec_pack_ops(action->pack_ops, action->pack_ops + action->num_pack_ops,
+		       body, 0, src);
+}
+
+/* get the source of top level subaction child - gathered or in src */
+static const void *codec_child_src(const struct ipct_pack_scope *child,
+				   const void *src,
+				   const struct ipct_gather *gather,
+				   uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		if (gather[i].offset == child->offset)
+			return gather[i].src - child->offset;
+	}
+
+	return src;
+}
+
+/**
+ * Pack C structure src into message body like codec_pack() but top level
+ * subaction C arrays listed in gather are read from their own source.
+ */
+void codec_pack_gather(const struct ipct_action *action, void *body,
+		       const void *src, const struct ipct_gather *gather,
+		       uint32_t count)
+{
+	const struct ipct_pack_scope *scope = &action->scope;
+	const struct ipct_codec_op *ops = action->pack_ops;
+	uint32_t first, last, i;
+
+	/* tuple headers and padding */
+	memcpy(body, action->template, action->plan_bytes);
+
+	/* top level elems are packed before any subaction */
+	last = scope->num_children ? scope->child[0].pack_op :
+		action->num_pack_ops;
+	codec_pack_ops(ops, ops + last, body, 0, src);
+
+	for (i = 0; i < scope->num_children; i++) {
+		first = scope->child[i].pack_op;
+		last = i + 1 < scope->num_children ?
+			scope->child[i + 1].pack_op : action->num_pack_ops;
+		codec_pack_ops(ops + first, ops + last, body, 0,
+			       codec_child_src(&scope->child[i], src, gather,
+					       count));
+	}
+}
+
+/* pack the wire bytes from lo to hi of op into wire */
+static void codec_pack_op_part(const struct ipct_codec_op *op, void *wire,
+			       const void *src, uint32_t lo, uint32_t hi)
+{
+	const void *c = src + op->c_offset;
+	uint32_t i, bytes, skip = lo - op->wire_offset;
+	uint16_t u16;
+
+	if (op->type == IPCT_OP_COPY) {
+		memcpy(wire, c + skip, hi - lo);
+		return;
+	}
+
+	/* 8 bit C data - widen each elem and copy the bytes in the window */
+	for (i = skip; i < hi - op->wire_offset; i += bytes) {
+		if (op->type == IPCT_OP_INT8)
+			u16 = *(const int8_t *)(c + i / sizeof(u16));
+		else
+			u16 = *(const uint8_t *)(c + i / sizeof(u16));
+
+		bytes = sizeof(u16) - i % sizeof(u16);
+		if (bytes > hi - op->wire_offset - i)
+			bytes = hi - op->wire_offset - i;
+		memcpy(wire + i - skip, (void *)&u16 + i % sizeof(u16), bytes);
+	}
+}
+
+/**
+ * Pack the packed body bytes from start to end into body. Ops are in body
+ * order and *op is the first op ending after start. Ops crossing start or
+ * end are packed in part and *op is updated for the next window.
+ */
+void codec_pack_window(const struct ipct_action *action, void *body,
+		       const void *src, uint32_t start, uint32_t end,
+		       uint32_t *op)
+{
+	const struct ipct_codec_op *cop;
+	uint32_t i, lo, hi;
+
+	/* tuple headers and padding */
+	memcpy(body, action->template + start, end - start);
+
+	for (i = *op; i < action->num_pack_ops; i++) {
+		cop = &action->pack_ops[i];
+		if (cop->wire_offset >= end)
+			break;
+
+		lo = cop->wire_offset > start ? cop->wire_offset : start;
+		hi = cop->wire_offset + cop->bytes < end ?
+			cop->wire_offset + cop->bytes : end;
+		if (lo == cop->wire_offset && hi == cop->wire_offset + cop->bytes)
+			codec_pack_ops(cop, cop + 1, body, start, src);
+		else
+			codec_pack_op_part(cop, body + lo - start, src, lo, hi);
+
+		/* op continues in the next window */
+		if (hi < cop->wire_offset + cop->bytes)
+			break;
+	}
+
+	*op = i;
+}
+
+/* validate the tuple data value of size bytes against the limits */
+static int codec_value_valid(uint32_t check, uint32_t size,
+			     const union ipct_op_limit *min,
+			     const union ipct_op_limit *max, const void *data)
+{
+	uint64_t u = 0;
+	int64_t i = 0;
+	uint16_t u16;
+	uint32_t u32;
+	float f;
+	double d;
+
+	switch (check) {
+	case IPCT_CHECK_UINT:
+	case IPCT_CHECK_MASK:
+	case IPCT_CHECK_INT:
+		switch (size) {
+		case sizeof(uint16_t):
+			memcpy(&u16, data, sizeof(u16));
+			u = u16;
+			i = (int16_t)u16;
+			break;
+		case sizeof(uint32_t):
+			memcpy(&u32, data, sizeof(u32));
+			u = u32;
+			i = (int32_t)u32;
+			break;
+		case sizeof(uint64_t):
+			memcpy(&u, data, sizeof(u));
+			i = (int64_t)u;
+			break;
+		default:
+			return 0;
+		}
+
+		if (check == IPCT_CHECK_UINT)
+			return u >= min->u && u <= max->u;
+		if (check == IPCT_CHECK_INT)
+			return i >= min->i && i <= max->i;
+
+		/* valid bits are in mask only */
+		return !(u & ~max->u);
+	case IPCT_CHECK_FLOAT:
+		memcpy(&f, data, sizeof(f));
+		return f >= min->d && f <= max->d;
+	case IPCT_CHECK_DOUBLE:
+		memcpy(&d, data, sizeof(d));
+		return d >= min->d && d <= max->d;
+	case IPCT_CHECK_NONE:
+	default:
+		return 1;
+	}
+}
+
+/* validate the op data - C arrays validate every elem */
+static int codec_op_data_valid(const struct ipct_codec_op *op,
+			       const void *data)
+{
+	uint32_t i;
+
+	for (i = 0; op->check && i < op->bytes; i += op->size) {
+		if (!codec_value_valid(op->check, op->size, &op->min, &op->max,
+				       data + i)) {
+			ipct_err("error: tuple id %d value out of range\n",
+				 op->id + i / op->size);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * Copy one verified tuple data elem into its C struct member at dest.
+ * Strings, data and uuids are zero padded to the C member size.
+ */
+void codec_conv_copy(const struct ipct_elem_conv *conv, void *dest,
+		     const void *data)
+{
+	switch (conv->type) {
+	case IPCT_CONV_8:
+		codec_narrow_8(dest, data, 1);
+		break;
+	case IPCT_CONV_16:
+		memcpy(dest, data, sizeof(uint16_t));
+		break;
+	case IPCT_CONV_32:
+		memcpy(dest, data, sizeof(uint32_t));
+		break;
+	case IPCT_CONV_64:
+		memcpy(dest, data, sizeof(uint64_t));
+		break;
+	case IPCT_CONV_BYTES:
+	default:
+		memcpy(dest, data, conv->copy_bytes);
+		memset(dest + conv->copy_bytes, 0,
+		       conv->c_size - conv->copy_bytes);
+		break;
+	}
+}
+
+/**
+ * Resolve elem into its converter, data size and pre-cast limits.
+ */
+void codec_conv_build(struct ipct_elem_conv *conv,
+		      struct ipct_elem_limit *limit,
+		      const struct ipct_tuple_elem *elem)
+{
+	struct ipct_codec_op op = {0};
+
+	conv->c_offset = elem->offset;
+	conv->c_size = elem_get_c_size(elem);
+	conv->data_size = elem_get_data_size(elem);
+	conv->copy_bytes = conv->c_size;
+
+	elem_op_check(elem, &op);
+	conv->check = op.check;
+	limit->min = op.min;
+	limit->max = op.max;
+
+	switch (elem->type) {
+	case ipct_type_string:
+	case ipct_type_data:
+		conv->copy_bytes = elem->value1;
+		conv->type = IPCT_CONV_BYTES;
+		return;
+	default:
+		break;
+	}
+
+	switch (conv->c_size) {
+	case sizeof(uint8_t):
+		conv->type = IPCT_CONV_8;
+		break;
+	case sizeof(uint16_t):
+		conv->type = IPCT_CONV_16;
+		break;
+	case sizeof(uint32_t):
+		conv->type = IPCT_CONV_32;
+		break;
+	case sizeof(uint64_t):
+		conv->type = IPCT_CONV_64;
+		break;
+	default:
+		conv->type = IPCT_CONV_BYTES;
+		break;
+	}
+}
+
+/**
+ * Validate the tuple data of tuple id for an elem against its pre-cast
+ * limits.
+ */
+int codec_conv_valid(const struct ipct_elem_conv *conv,
+		     const struct ipct_elem_limit *limit, uint32_t id,
+		     const void *data)
+{
+	if (!conv->check)
+		return 1;
+
+	if (!codec_value_valid(conv->check, conv->data_size, &limit->min,
+			       &limit->max, data)) {
+		ipct_err("error: tuple id %d value out of range\n", id);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* does the message body have the tuple layout produced by our pack plan ? */
+static int codec_layout_match(const struct ipct_action *action,
+			      const void *body, uint32_t size, uint32_t tuples)
+{
+	const struct ipct_tuple_check *check = action->tuple_checks;
+	uint32_t value;
+	int i;
+
+	if (size != action->plan_bytes || tuples != action->num_tuples)
+		return 0;
+
+	for (i = 0; i < action->num_checks; i++, check++) {
+		memcpy(&value, body + check->offset, sizeof(value));
+		if ((value & check->mask) != check->value)
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Validate message body values without unpacking. Only messages with the
+ * exact tuple layout of our pack plan are handled.
+ *
+ * Returns 1 if valid, 0 if the layout does not match or a negative error
+ * code.
+ */
+int codec_check(const struct ipct_action *action, const void *body,
+		uint32_t size, uint32_t tuples)
+{
+	const struct ipct_codec_op *op = action->unpack_ops;
+	const struct ipct_codec_op *end = op + action->num_unpack_ops;
+
+	if (!codec_layout_match(action, body, size, tuples))
+		return 0;
+
+	for (; op < end; op++) {
+		if (!codec_op_data_valid(op, body + op->wire_offset))
+			return -EINVAL;
+	}
+
+	return 1;
+}
+
+/**
+ * Unpack message body into C structure dest using the compiled unpack ops.
+ * Only messages with the exact tuple layout of our pack plan are handled.
+ * The whole body is validated before anything is copied.
+ *
+ * Returns 1 if unpacked, 0 if the layout does not match and the message
+ * must be unpacked tuple by tuple or a negative error code.
+ */
+int codec_unpack(const struct ipct_action *action, void *dest,
+		 const void *body, uint32_t size, uint32_t tuples)
+{
+	const struct ipct_codec_op *op = action->unpack_ops;
+	const struct ipct_codec_op *end = op + action->num_unpack_ops;
+	const void *data;
+	int ret;
+
+	ret = codec_check(action, body, size, tuples);
+	if (ret <= 0)
+		return ret;
+
+	/* body is valid - copy only */
+	for (; op < end; op++) {
+		data = body + op->wire_offset;
+
+		switch (op->type) {
+		case IPCT_OP_COPY:
+			memcpy(dest + op->c_offset, data, op->bytes);
+			break;
+		case IPCT_OP_ZERO:
+			memset(dest + op->c_offset, 0, op->bytes);
+			break;
+		case IPCT_OP_UINT8:
+		case IPCT_OP_INT8:
+			codec_narrow_8(dest + op->c_offset, data,
+				       op->bytes / sizeof(uint16_t));
+			break;
+		default:
+			break;
+		}
+	}
+
+	return 1;
+}
@@ -0,0 +1,471 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * IPCT contexts - each context has its own klass registry and stats so
+ * contexts for different peers or cores never share any state.
+ */
+
+/* caller must be in a registry read section while action is used */
+const struct ipct_action *get_action(struct ipct_context *ipct, uint32_t id)
+{
+	const struct ipct_action *action;
+
+	action = registry_get_action(&ipct->registry, id);
+	if (!action) {
+		/* not found */
+		ipct_err("error: can't find klass 0x%x subklass 0x%x action 0x%x from ID 0x%x\n",
+			IPCT_ID_GET_KLASS(id), IPCT_ID_GET_SUBKLASS(id),
+			IPCT_ID_GET_ACTION(id), id);
+		return NULL;
+	}
+
+	return action;
+}
+
+/* statistics are only read by the client so relaxed ordering is enough */
+static inline void stats_add(atomic_ullong *stat, uint64_t value)
+{
+	atomic_fetch_add_explicit(stat, value, memory_order_relaxed);
+}
+
+void context_init(struct ipct_context *ipct)
+{
+	registry_init(&ipct->registry);
+	ipct->addr = 0;
+	atomic_init(&ipct->stats.msgs_packed, 0);
+	atomic_init(&ipct->stats.msgs_unpacked, 0);
+	atomic_init(&ipct->stats.bytes_packed, 0);
+	atomic_init(&ipct->stats.bytes_unpacked, 0);
+	atomic_init(&ipct->stats.pack_errors, 0);
+	atomic_init(&ipct->stats.unpack_errors, 0);
+}
+
+/** \brief
+ *  Create an IPCT context with its own registry of klasses. klasses can be
+ *  NULL and klasses can also be registered later.
+ */
+struct ipct_context *ipct_ctx_create(const struct ipct_klass_list *klasses)
+{
+	struct ipct_context *ipct;
+
+	ipct = malloc(sizeof(*ipct));
+	if (!ipct)
+		return NULL;
+	context_init(ipct);
+
+	if (klasses && registry_add_list(&ipct->registry, klasses) < 0) {
+		ipct_err("error: can't register context klasses\n");
+		ipct_ctx_free(ipct);
+		return NULL;
+	}
+
+	return ipct;
+}
+
+/** \brief
+ *  Free context and all its klass tables. The context must not be in use.
+ */
+void ipct_ctx_free(struct ipct_context *ipct)
+{
+	registry_free(&ipct->registry);
+	free(ipct);
+}
+
+/** \brief
+ *  Set the sender address used in the route header of messages packed with
+ *  context ipct.
+ */
+void ipct_ctx_set_addr(struct ipct_context *ipct, uint32_t addr)
+{
+	ipct->addr = addr;
+}
+
+int ipct_ctx_register_klass(struct ipct_context *ipct,
+			    const struct ipct_klass_def *klass)
+{
+	return registry_add(&ipct->registry, klass);
+}
+
+int ipct_ctx_unregister_klass(struct ipct_context *ipct, uint32_t klass_id)
+{
+	return registry_remove(&ipct->registry, klass_id);
+}
+
+/** \brief
+ *  Create an IPCT style message from source C structure and pack into
+ *  destination buffer using the klasses of context ipct. Returns the size
+ *  in bytes, -ENOSPC if it doesn't fit in dest or a negative error code.
+ */
+int ipct_ctx_msg_pack(struct ipct_context *ipct, uint32_t id,
+		      void *src, size_t src_size, void *dest, size_t dest_size,
+		      uint32_t flags, uint32_t dest_addr)
+{
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	/* setup context */
+	msg.ipct = ipct;
+	msg.id = id;
+	msg.addr = dest_addr;
+	msg.flags = flags;
+	msg.src.base = src;
+	msg.src.offset = 0;
+	msg.src.size = src_size;
+	msg.dest.base = dest;
+	msg.dest.offset = 0;
+	msg.dest.size = dest_size;
+
+	/* now pack the data */
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_pack(&msg);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0) {
+		ipct_err("ipct: error failed to pack object 0x%x\n", id);
+		stats_add(&ipct->stats.pack_errors, 1);
+		return ret;
+	}
+
+	stats_add(&ipct->stats.msgs_packed, 1);
+	stats_add(&ipct->stats.bytes_packed, ret);
+	return ret;
+}
+
+/** \brief
+ *  Create an IPCT style message from source C structure and the gathered
+ *  subaction C arrays and pack into destination buffer.
+ */
+int ipct_ctx_msg_pack_gather(struct ipct_context *ipct, uint32_t id,
+			     void *src, size_t src_size,
+			     const struct ipct_gather *gather, int count,
+			     void *dest, size_t dest_size,
+			     uint32_t flags, uint32_t dest_addr)
+{
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	/* setup context */
+	msg.ipct = ipct;
+	msg.id = id;
+	msg.addr = dest_addr;
+	msg.flags = flags;
+	msg.src.base = src;
+	msg.src.offset = 0;
+	msg.src.size = src_size;
+	msg.dest.base = dest;
+	msg.dest.offset = 0;
+	msg.dest.size = dest_size;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_pack_gather(&msg, gather, count);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0) {
+		ipct_err("ipct: error failed to pack object 0x%x\n", id);
+		stats_add(&ipct->stats.pack_errors, 1);
+		return ret;
+	}
+
+	stats_add(&ipct->stats.msgs_packed, 1);
+	stats_add(&ipct->stats.bytes_packed, ret);
+	return ret;
+}
+
+/** \brief
+ *  Create an IPCT style message from source C structure and pack it straight
+ *  into the iovcnt destination segments in iov. Returns the message size,
+ *  -ENOSPC if it doesn't fit in the segments or a negative error code.
+ */
+int ipct_ctx_msg_pack_iov(struct ipct_context *ipct, uint32_t id,
+			  void *src, size_t src_size,
+			  const struct ipct_iovec *iov, int iovcnt,
+			  uint32_t flags, uint32_t dest_addr)
+{
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	/* setup context - headers and body go to the segments */
+	msg.ipct = ipct;
+	msg.id = id;
+	msg.addr = dest_addr;
+	msg.flags = flags;
+	msg.src.base = src;
+	msg.src.offset = 0;
+	msg.src.size = src_size;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_pack_iov(&msg, iov, iovcnt);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0) {
+		ipct_err("ipct: error failed to pack object 0x%x\n", id);
+		stats_add(&ipct->stats.pack_errors, 1);
+		return ret;
+	}
+
+	stats_add(&ipct->stats.msgs_packed, 1);
+	stats_add(&ipct->stats.bytes_packed, ret);
+	return ret;
+}
+
+/** \brief
+ *  Get the exact size in bytes of the message ipct_ctx_msg_pack() creates
+ *  for action ID with the same flags and dest_addr. Returns the size or a
+ *  negative error code.
+ */
+int ipct_ctx_msg_packed_size(struct ipct_context *ipct, uint32_t id,
+			     uint32_t flags, uint32_t dest_addr)
+{
+	const struct ipct_action *action;
+	uint32_t epoch;
+	int ret = -EINVAL;
+
+	epoch = registry_read_lock(&ipct->registry);
+	action = get_action(ipct, id);
+
+	/* all elems are fixed size so size only depends on the action */
+	if (action)
+		ret = pack_hdr_size(flags, dest_addr) + action->plan_bytes;
+	registry_read_unlock(&ipct->registry, epoch);
+
+	return ret;
+}
+
+/** \brief
+ *  Get the worst case size in bytes of any message for action ID.
+ *  Returns the size or a negative error code.
+ */
+int ipct_ctx_msg_max_size(struct ipct_context *ipct, uint32_t id)
+{
+	const struct ipct_action *action;
+	uint32_t epoch;
+	int ret = -EINVAL;
+
+	epoch = registry_read_lock(&ipct->registry);
+	action = get_action(ipct, id);
+	if (action)
+		ret = IPCT_HDR_MAX_SIZE + action->plan_bytes;
+	registry_read_unlock(&ipct->registry, epoch);
+
+	return ret;
+}
+
+/** \brief
+ *  received IPCT message - id, dest_addr and IPCT_FLAGS_* flags are taken
+ *  from the message header if requested.
+ */
+int ipct_ctx_msg_unpack(struct ipct_context *ipct, void *src, size_t src_size,
+			void *dest, size_t dest_size,
+			uint32_t *id, uint32_t *dest_addr, uint32_t *flags)
+{
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	/* setup context */
+	msg.ipct = ipct;
+	msg.id = 0;
+	msg.addr = 0;
+	msg.flags = 0;
+	msg.src.base = src;
+	msg.src.offset = 0;
+	msg.src.size = src_size;
+	msg.dest.base = dest;
+	msg.dest.offset = 0;
+	msg.dest.size = dest_size;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_unpack(&msg);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0) {
+		stats_add(&ipct->stats.unpack_errors, 1);
+		return ret;
+	}
+
+	stats_add(&ipct->stats.msgs_unpacked, 1);
+	stats_add(&ipct->stats.bytes_unpacked, msg.src.offset);
+
+	/* assign id and address if requested */
+	if (id)
+		*id = msg.id;
+	if (dest_addr)
+		*dest_addr = msg.addr;
+	if (flags)
+		*flags = msg.flags;
+
+	return 0;
+}
+
+/** \brief
+ *  Start packing action ID from source C structure as a compound message of
+ *  chunks of at most chunk_size bytes. Returns the number of chunks, -ENOSPC
+ *  if a tuple doesn't fit in one chunk or a negative error code.
+ */
+int ipct_ctx_msg_stream_init(struct ipct_context *ipct,
+			     struct ipct_msg_stream *stream, uint32_t id,
+			     void *src, size_t src_size, size_t chunk_size,
+			     uint32_t flags, uint32_t dest_addr)
+{
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	stream->ipct = ipct;
+	stream->id = id;
+	stream->flags = flags;
+	stream->dest_addr = dest_addr;
+	stream->src = src;
+	stream->src_size = src_size;
+	stream->chunk_size = chunk_size;
+	stream->remaining = 0;
+
+	msg.ipct = ipct;
+	msg.id = id;
+	msg.addr = dest_addr;
+	msg.flags = flags;
+	msg.src.base = src;
+	msg.src.offset = 0;
+	msg.src.size = src_size;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_pack_stream_init(&msg, stream);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0)
+		stats_add(&ipct->stats.pack_errors, 1);
+
+	return ret;
+}
+
+/** \brief
+ *  Pack the next chunk of the compound message into dest. Returns the chunk
+ *  size in bytes, 0 once every chunk is packed, -ENOSPC if the chunk doesn't
+ *  fit in dest or a negative error code.
+ */
+int ipct_msg_stream_next(struct ipct_msg_stream *stream, void *dest,
+			 size_t dest_size)
+{
+	struct ipct_context *ipct = stream->ipct;
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	msg.ipct = ipct;
+	msg.id = stream->id;
+	msg.addr = stream->dest_addr;
+	msg.flags = stream->flags;
+	msg.src.base = stream->src;
+	msg.src.offset = 0;
+	msg.src.size = stream->src_size;
+	msg.dest.base = dest;
+	msg.dest.offset = 0;
+	msg.dest.size = dest_size;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_pack_chunk(&msg, stream);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0) {
+		ipct_err("ipct: error failed to pack chunk of 0x%x\n",
+			 stream->id);
+		stats_add(&ipct->stats.pack_errors, 1);
+		return ret;
+	}
+
+	if (ret) {
+		stats_add(&ipct->stats.msgs_packed, 1);
+		stats_add(&ipct->stats.bytes_packed, ret);
+	}
+	return ret;
+}
+
+/** \brief
+ *  Start reassembling received compound messages into C structure dest.
+ */
+int ipct_ctx_msg_reasm_init(struct ipct_context *ipct,
+			    struct ipct_msg_reasm *reasm, void *dest,
+			    size_t dest_size)
+{
+	reasm->ipct = ipct;
+	reasm->id = 0;
+	reasm->dest_addr = 0;
+	reasm->flags = 0;
+	reasm->dest = dest;
+	reasm->dest_size = dest_size;
+	reasm->remaining = 0;
+	reasm->tuples = 0;
+
+	return 0;
+}
+
+/** \brief
+ *  Unpack received chunk of a compound message. Returns the number of
+ *  chunks still to come, 0 once the message is complete or a negative error
+ *  code. Any error drops the message in progress.
+ */
+int ipct_msg_reasm_add(struct ipct_msg_reasm *reasm, void *src,
+		       size_t src_size)
+{
+	struct ipct_context *ipct = reasm->ipct;
+	struct ipct_msg_context msg;
+	uint32_t epoch;
+	int ret;
+
+	msg.ipct = ipct;
+	msg.id = 0;
+	msg.addr = 0;
+	msg.flags = 0;
+	msg.src.base = src;
+	msg.src.offset = 0;
+	msg.src.size = src_size;
+	msg.dest.base = reasm->dest;
+	msg.dest.offset = 0;
+	msg.dest.size = reasm->dest_size;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = ipct_unpack_chunk(&msg, reasm);
+	registry_read_unlock(&ipct->registry, epoch);
+	if (ret < 0) {
+		reasm->remaining = 0;
+		stats_add(&ipct->stats.unpack_errors, 1);
+		return ret;
+	}
+
+	stats_add(&ipct->stats.bytes_unpacked, msg.src.offset);
+	if (!ret)
+		stats_add(&ipct->stats.msgs_unpacked, 1);
+
+	return ret;
+}
+
+/** \brief
+ *  Get a snapshot of the context message statistics.
+ */
+void ipct_ctx_get_stats(struct ipct_context *ipct,
+			struct ipct_ctx_stats *stats)
+{
+	stats->msgs_packed = atomic_load_explicit(&ipct->stats.msgs_packed,
+						  memory_order_relaxed);
+	stats->msgs_unpacked = atomic_load_explicit(&ipct->stats.msgs_unpacked,
+						    memory_order_relaxed);
+	stats->bytes_packed = atomic_load_explicit(&ipct->stats.bytes_packed,
+						   memory_order_relaxed);
+	stats->bytes_unpacked = atomic_load_explicit(&ipct->stats.bytes_unpacked,
+						     memory_order_relaxed);
+	stats->pack_errors = atomic_load_explicit(&ipct->stats.pack_errors,
+						  memory_order_relaxed);
+	stats->unpack_errors = atomic_load_explicit(&ipct->stats.unpack_errors,
+						    memory_order_relaxed);
+}
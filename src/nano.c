@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Nano and micro messages - the 32 bit header only and 64 bit header and
+ * micro tuple messages of header.h use cases 1) and 2). They have no route
+ * or elems headers so they fit in the doorbell registers and are packed and
+ * unpacked without any action lookup. Micro messages set the block bit,
+ * which data blocks never use without elems, so the header alone tells
+ * them apart even in a batch or a larger mailbox.
+ */
+
+struct ipct_micro_msg {
+	struct ipct_hdr hdr;
+	struct ipct_elem_micro micro;
+} __attribute__((packed, aligned(4)));
+
+static int nano_hdr_init(struct ipct_hdr *hdr, uint32_t id, uint32_t flags)
+{
+	/* no route header */
+	if (pack_has_route(flags, 0)) {
+		ipct_err("error: nano message 0x%x can't be routed\n", id);
+		return -EINVAL;
+	}
+
+	*((uint32_t *)hdr) = id & 0x00ffffff;
+	pack_hdr_flags(hdr, flags);
+	return 0;
+}
+
+/** \brief
+ *  Pack header only 32 bit message ID into dest.
+ *  Returns the message size in bytes or a negative error code.
+ */
+int ipct_msg_pack_nano(uint32_t id, uint32_t flags, void *dest,
+		       size_t dest_size)
+{
+	struct ipct_hdr hdr;
+	int ret;
+
+	if (dest_size < IPCT_MSG_NANO_SIZE)
+		return -EINVAL;
+
+	ret = nano_hdr_init(&hdr, id, flags);
+	if (ret < 0)
+		return ret;
+
+	memcpy(dest, &hdr, sizeof(hdr));
+	return IPCT_MSG_NANO_SIZE;
+}
+
+/** \brief
+ *  Pack 64 bit message ID with a single micro tuple tuple_id of value into
+ *  dest. Returns the message size in bytes or a negative error code.
+ */
+int ipct_msg_pack_micro(uint32_t id, uint32_t flags, uint32_t tuple_id,
+			uint16_t value, void *dest, size_t dest_size)
+{
+	struct ipct_micro_msg msg;
+	int ret;
+
+	if (dest_size < IPCT_MSG_MICRO_SIZE)
+		return -EINVAL;
+
+	if (tuple_id > IPCT_TUPLE_MAX_ID) {
+		ipct_err("error: micro message 0x%x tuple id %d out of range\n",
+			 id, tuple_id);
+		return -EINVAL;
+	}
+
+	ret = nano_hdr_init(&msg.hdr, id, flags);
+	if (ret < 0)
+		return ret;
+
+	msg.hdr.block = 1;
+	msg.micro.tuple.type = IPCT_TUPLE_TYPE_HD;
+	msg.micro.tuple.id = tuple_id;
+	msg.micro.data = value;
+
+	memcpy(dest, &msg, sizeof(msg));
+	return IPCT_MSG_MICRO_SIZE;
+}
+
+/** \brief
+ *  Classify received message of src_size bytes as IPCT_MSG_CLASS_NANO,
+ *  IPCT_MSG_CLASS_MICRO or IPCT_MSG_CLASS_STD for ipct_msg_unpack().
+ *  src_size must be the message size and not the mailbox size. Returns a
+ *  negative error code if the message is malformed.
+ */
+int ipct_msg_classify(void *src, size_t src_size)
+{
+	struct ipct_micro_msg *msg = src;
+
+	if (src_size < IPCT_MSG_NANO_SIZE)
+		return -EINVAL;
+
+	if (msg->hdr.route || msg->hdr.elems)
+		return IPCT_MSG_CLASS_STD;
+
+	if (!msg->hdr.block && src_size == IPCT_MSG_NANO_SIZE)
+		return IPCT_MSG_CLASS_NANO;
+
+	if (msg->hdr.block && src_size == IPCT_MSG_MICRO_SIZE &&
+	    msg->micro.tuple.type == IPCT_TUPLE_TYPE_HD)
+		return IPCT_MSG_CLASS_MICRO;
+
+	ipct_err("ipct: error message 0x%x size %zu has no elems\n",
+		 IPCT_HDR_GET_ID(&msg->hdr), src_size);
+	return -EINVAL;
+}
+
+/** \brief
+ *  Unpack nano message ID and IPCT_FLAGS_* from src.
+ */
+int ipct_msg_unpack_nano(void *src, size_t src_size, uint32_t *id,
+			 uint32_t *flags)
+{
+	struct ipct_hdr *hdr = src;
+
+	if (ipct_msg_classify(src, src_size) != IPCT_MSG_CLASS_NANO)
+		return -EINVAL;
+
+	*id = IPCT_HDR_GET_ID(hdr);
+	*flags = unpack_hdr_flags(hdr);
+	return 0;
+}
+
+/** \brief
+ *  Unpack micro message ID, IPCT_FLAGS_* and micro tuple from src.
+ */
+int ipct_msg_unpack_micro(void *src, size_t src_size, uint32_t *id,
+			  uint32_t *flags, uint32_t *tuple_id, uint16_t *value)
+{
+	struct ipct_micro_msg *msg = src;
+
+	if (ipct_msg_classify(src, src_size) != IPCT_MSG_CLASS_MICRO)
+		return -EINVAL;
+
+	*id = IPCT_HDR_GET_ID(&msg->hdr);
+	*flags = unpack_hdr_flags(&msg->hdr);
+	*tuple_id = msg->micro.tuple.id;
+	*value = msg->micro.data;
+	return 0;
+}
@@ -8,361 +8,455 @@
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include <ipct/client.h>
 #include <ipct/builder.h>
 #include "priv.h"
 
-/* pack C structure data into a new tuple */
-static int ipc_pack_single(const struct ipct_action_struct_desc *action,
-			   const struct ipct_tuple_elem *elem,
-			   struct ipct_msg_context *ctx,
-			   struct ipct_tuple **cont_tuple)
+static inline void init_header(struct ipct_msg_context *ctx)
 {
-	struct ipct_tuple *tuple;
-	uint32_t elem_data_size;
-	void *tuple_data;
-	enum ipct_tuple_elem_type tuple_type;
-	int err;
-
-	log_elem_dump(__func__, elem);
-
-	/* are we a standard or high density tuple type ? */
-	tuple_type = ipct_get_type(elem->type);
-
-	/* check: is elem data size valid ? */
-	elem_data_size = elem_get_data_size(elem);
-	if (!elem_data_size) {
-		ipct_err("error: invalid elem %d data size %d\n",
-			elem->id, elem_data_size);
-		return -EINVAL;
-	}
-
-	/* check: is elem offset within C structure */
-	if (elem->offset + elem_data_size > ctx->src.size) {
-		ipct_err("error: elem outside structure\n");
-		return -EINVAL;
-	}
-
-	/* check: is tuple starting point within buffer ? */
-	tuple = ctx->dest.base + ctx->dest.offset;
-	if (!is_ptr_valid(&ctx->dest, tuple)) {
-		ipct_err("error: tuple starts outside of buffer\n");
-		return -EINVAL;
-	}
-
-	/* setup new tuple */
-	err = tuple_init(tuple, tuple_type, elem->id, elem_data_size);
-	if (err < 0) {
-		ipct_err("error: failed to init tuple type %d\n",
-			tuple_type);
-		return err;
-	}
+	struct ipct_hdr *hdr = ctx->dest.base;
+	struct sof_ipct_route *route;
 
-	/* get new tuple data offset */
-	tuple_data = tuple_get_data(tuple, 0);
-	if (!tuple_data){
-		ipct_err("error: failed to get tuple data\n");
-		return -EINVAL;
-	}
+	/* set header klass, sublkass and action - clear other flags */
+	*((uint32_t*)hdr) = ctx->id & 0x00ffffff;
 
-	/* this is the continuous tuple starting point */
-	*cont_tuple = tuple;
+	/* set any header flags */
+	pack_hdr_flags(hdr, ctx->flags);
+	hdr->route = pack_has_route(ctx->flags, ctx->addr);
+	hdr->elems = 1;
 
-	/* check: is tuple end (including it's payload) within buffer */
-	if ((tuple_data + elem_data_size) >= ctx->dest.base + ctx->dest.size ||
-		tuple_data < ctx->dest.base) {
-		ipct_err("error: tuple outside of buffer\n");
-		return -EINVAL;
+	/* route - broadcast overrides any receiver address */
+	route = IPCT_HDR_GET_ROUTE_PTR(hdr);
+	if (route) {
+		route->receiver = ctx->flags & IPCT_FLAGS_BROADCAST ?
+			SOF_IPCT_ROUTE_BROADCAST : ctx->addr;
+		route->sender = ctx->ipct->addr;
 	}
 
-	/* copy the data */
-	memcpy(tuple_data, ctx->src.base + elem->offset, elem_data_size);
-
-	log_pack_dump(__func__, ctx->dest.offset, elem);
+	ctx->dest.offset = IPCT_HDR_GET_HDR_SIZE(hdr);
 
-	/* return the new offset */
-	return tuple_size(tuple);
+	ipct_log("pack: hdr %d:%d:%d size 0x%zu\n",
+		hdr->klass, hdr->subklass, hdr->action, ctx->dest.offset);
 }
 
-/* pack C structure data into an existing tuple - tuple already created above */
-static int ipc_pack_cont(const struct ipct_action_struct_desc *action,
-			   const struct ipct_tuple_elem *elem,
-			   struct ipct_msg_context *ctx,
-			   struct ipct_tuple *cont_tuple)
+/* set the elems header for tuples in a body of size bytes */
+static inline int set_elems(struct ipct_hdr *hdr, uint32_t tuples,
+			    uint32_t remaining, uint32_t size)
 {
-	uint32_t elem_data_size;
-	void *tuple_data;
-	int size_increase;
-
-	log_elem_dump(__func__, elem);
+	struct sof_ipct_elems *elems = IPCT_HDR_GET_ELEM_PTR(hdr);
 
-	/* check: is tuple data size valid ? */
-	elem_data_size = elem_get_data_size(elem);
-	if (!elem_data_size) {
-		ipct_err("error: invalid elem data size\n");
+	if (!elems) {
+		ipct_err("pack: object has no elems\n");
 		return -EINVAL;
 	}
 
-	/* check: is elem offset within C structure */
-	if (elem->offset + elem_data_size > ctx->src.size) {
-		ipct_err("error: elem outside structure\n");
-		return -EINVAL;
-	}
+	elems->num_tuples = tuples;
+	elems->remaining = remaining;
 
-	/* update tuple */
-	size_increase = tuple_inc_elems(cont_tuple);
-	if (size_increase < 0) {
-		ipct_err("error: invalid conversion to tuple array\n");
-		return size_increase;
-	}
-	ctx->dest.offset += size_increase;
+	size = size >> 2; /* convert bytes to words */
 
-	/* check: is tuple starting point within buffer ? */
-	tuple_data = ctx->dest.base + ctx->dest.offset;
-	if (!is_ptr_valid(&ctx->dest, tuple_data)) {
-		ipct_err("error: tuple starts outside of buffer\n");
+	/* validate size as elems->size is 24 bits */
+	if (size >= 1 << 24) {
+		ipct_err("error: tuple too big\n");
 		return -EINVAL;
 	}
 
-	/* check: is tuple end (including it's payload) within buffer */
-	if ((tuple_data + elem_data_size) >= ctx->dest.base + ctx->dest.size ||
-		tuple_data < ctx->dest.base) {
-		ipct_err("error: tuple outside of buffer\n");
-		return -EINVAL;
-	}
+	elems->size = size;
+	return 0;
+}
 
-	/* copy the data */
-	memcpy(tuple_data, ctx->src.base + elem->offset, elem_data_size);
+static inline int complete_header(struct ipct_msg_context *ctx, uint32_t tuples,
+				  uint32_t remaining)
+{
+	struct ipct_hdr *hdr = ctx->dest.base;
+	int ret;
 
-	log_pack_dump(__func__, ctx->dest.offset, elem);
+	/* subtract headers */
+	ret = set_elems(hdr, tuples, remaining,
+			ctx->dest.offset - IPCT_HDR_GET_HDR_SIZE(hdr));
+	if (ret < 0)
+		return ret;
 
-	/* return the new offset */
-	return tuple_data_size(cont_tuple);
+	dump_raw("pack: result", ctx->dest.base, ctx->dest.offset);
+
+	return ctx->dest.offset;
 }
 
-/* get the first elem by lowest ID or NULL */
-static const struct ipct_tuple_elem *get_first_elem(const struct ipct_action_struct_desc *action)
+/* get the action for ctx and check the source C struct can be packed */
+static const struct ipct_action *pack_get_action(struct ipct_msg_context *ctx)
 {
-	const struct ipct_tuple_elem *elem, *first = NULL;
-	const struct ipct_tuple_set *set;
-	uint16_t id = IPCT_TUPLE_MAX_ID;
-	int i;
-
-	/* search elem by elem - mandatory first */
-	set = &action->mandatory;
-	for (i = 0; i < set->count; i++) {
-		elem = &set->elem[i];
-		if (elem->id < id) {
-			first = elem;
-			id = elem->id;
-		}
-	}
+	const struct ipct_action *action;
+	const struct ipct_action_struct_desc *desc;
 
-	/* search elem by elem - optional next */
-	set = &action->optional;
-	for (i = 0; i < set->count; i++) {
-		elem = &set->elem[i];
-		if (elem->id == id) {
-			first = elem;
-			id = elem->id;
-		}
+	/* validate ID - is it supported ? */
+	action = get_action(ctx->ipct, ctx->id);
+	if (!action) {
+		ipct_err("ipct: error can't find action 0x%x\n", ctx->id);
+		return NULL;
 	}
+	desc = action->def->desc;
 
-	return first;
-}
+	ipct_log("pack: action size %d mandatory %d optional %d\n",
+		desc->size, desc->mandatory.count, desc->optional.count);
 
-/*get next elem in numerical order after ID or NULL */
-static const struct ipct_tuple_elem *get_next_elem(const struct ipct_action_struct_desc *action,
-		const struct ipct_tuple_elem *current)
-{
-	const struct ipct_tuple_elem *next_elem = NULL, *elem;
-	const struct ipct_tuple_set *set;
-	int i;
-	uint16_t next_id = IPCT_TUPLE_MAX_ID;
-
-	/* search elem by elem - mandatory first */
-	set = &action->mandatory;
-	for (i = 0; i < set->count; i++) {
-		elem = &set->elem[i];
-
-		if (elem->id > current->id && elem->id < next_id) {
-			next_elem = elem;
-			next_id = elem->id;
-		}
+	/* has user provided enough space to pack from ? */
+	if (ctx->src.size < desc->size) {
+		ipct_err("ipct: error action 0x%x not enough packing space %d need %ld\n",
+			ctx->id, desc->size, ctx->src.size);
+		return NULL;
 	}
 
-	/* search elem by elem - optional next */
-	set = &action->optional;
-	for (i = 0; i < set->count; i++) {
-		elem = &set->elem[i];
-
-		if (elem->id > current->id && elem->id < next_id) {
-			next_elem = elem;
-			next_id = elem->id;
-		}
+	if (!action->num_tuples && !action_is_block(action)) {
+		ipct_err("error: no elems to pack in 0x%x\n", ctx->id);
+		return NULL;
 	}
 
-	return next_elem;
+	return action;
 }
 
-static const struct ipct_tuple_elem *continuous_elems(const struct ipct_action_struct_desc *action,
-		const struct ipct_tuple_elem *current)
+/* copy the private data block and zero the padding to the next word */
+static void pack_block(const struct ipct_action *action, void *body,
+		       const void *src)
 {
-	const struct ipct_tuple_elem *next = current;
+	uint32_t size = action->def->desc->size;
 
-	/* find continuous IDs with the same tuple type */
-	next = get_next_elem(action, current);
-	if (!next)
-		return NULL;
+	memcpy(body, src, size);
+	memset(body + size, 0, action->plan_bytes - size);
+}
 
-	/* must have sequential ID */
-	if (current->id + 1 != next->id)
-		return NULL;
+/**
+ * Convert message from internal C struct to tuples.
+ */
+int ipct_pack(struct ipct_msg_context *ctx)
+{
+	const struct ipct_action *action;
+	uint32_t size;
 
-	/* must have same type */
-	if (ipct_get_type(current->type) != ipct_get_type(next->type))
-		return NULL;
+	ipct_log("pack: id 0x%x\n",ctx-> id);
 
-	return next;
-}
+	action = pack_get_action(ctx);
+	if (!action)
+		return -EINVAL;
 
-static inline void init_header(struct ipct_msg_context *ctx)
-{
-	struct ipct_hdr *hdr = ctx->dest.base;
+	/* check: does the message fit in the buffer ? */
+	size = pack_hdr_size(ctx->flags, ctx->addr) + action->plan_bytes;
+	if (size > ctx->dest.size) {
+		ipct_err("error: action 0x%x needs %d bytes buffer is %zu\n",
+			 ctx->id, size, ctx->dest.size);
+		return -ENOSPC;
+	}
 
-	/* set header klass, sublkass and action - clear other flags */
-	*((uint32_t*)hdr) = ctx->id;
+	/* create header */
+	init_header(ctx);
 
-	/* set any header flags */
-	hdr->elems = 1;
+	/* private data block - no tuples */
+	if (action_is_block(action)) {
+		((struct ipct_hdr *)ctx->dest.base)->block = 1;
+		pack_block(action, ctx->dest.base + ctx->dest.offset,
+			   ctx->src.base);
+		ctx->dest.offset += action->plan_bytes;
+		return complete_header(ctx, 0, 0);
+	}
 
-	ctx->dest.offset = IPCT_HDR_GET_HDR_SIZE(hdr);
+	/* pack the tuples */
+	codec_pack(action, ctx->dest.base + ctx->dest.offset, ctx->src.base);
+	ctx->dest.offset += action->plan_bytes;
 
-	ipct_log("pack: hdr %d:%d:%d size 0x%zu\n",
-		hdr->klass, hdr->subklass, hdr->action, ctx->dest.offset);
+	/* finished */
+	return complete_header(ctx, action->num_tuples, 0);
 }
 
-static inline int complete_header(struct ipct_msg_context *ctx, uint32_t tuples)
+/**
+ * Convert message from internal C struct to tuples reading the top level
+ * subaction C arrays in gather from their own source.
+ */
+int ipct_pack_gather(struct ipct_msg_context *ctx,
+		     const struct ipct_gather *gather, int count)
 {
-	struct ipct_hdr *hdr = ctx->dest.base;
-	struct sof_ipct_elems *elems = IPCT_HDR_GET_ELEM_PTR(hdr);
-	uint32_t offset = ctx->dest.offset;
+	const struct ipct_action *action;
+	const struct ipct_pack_scope *child;
+	uint32_t src_bytes, size, num, i, j;
 
-	if (!elems) {
-		ipct_err("pack: object has no elems\n");
+	if (count < 0) {
+		ipct_err("error: gather count %d is negative\n", count);
 		return -EINVAL;
 	}
+	num = count;
 
-	elems->num_tuples = tuples;
-	elems->remaining = 0;	// TODO:
+	action = get_action(ctx->ipct, ctx->id);
+	if (!action) {
+		ipct_err("ipct: error can't find action 0x%x\n", ctx->id);
+		return -EINVAL;
+	}
 
-	offset -= IPCT_HDR_GET_HDR_SIZE(hdr); /* subtract headers */
-	offset = offset >> 2; /* convert bytes to words */
+	if (action_is_block(action)) {
+		ipct_err("error: block action 0x%x has no subactions\n",
+			 ctx->id);
+		return -EINVAL;
+	}
 
-	/* validate size as elems->size is 24 bits */
-	if (offset >= 1 << 24) {
-		ipct_err("error: tuple too big\n");
+	if (!action->num_tuples) {
+		ipct_err("error: no elems to pack in 0x%x\n", ctx->id);
 		return -EINVAL;
 	}
 
-	elems->size = offset;
+	/* every gathered source must be a top level subaction */
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < action->scope.num_children; j++) {
+			if (action->scope.child[j].offset == gather[i].offset)
+				break;
+		}
+		if (j == action->scope.num_children || !gather[i].src) {
+			ipct_err("error: action 0x%x has no subaction at offset %zu\n",
+				 ctx->id, gather[i].offset);
+			return -EINVAL;
+		}
+	}
 
-	dump_raw("pack: result", ctx->dest.base, ctx->dest.offset);
+	/* src only needs the top level elems and subactions not gathered */
+	src_bytes = action->src_bytes;
+	for (j = 0; j < action->scope.num_children; j++) {
+		child = &action->scope.child[j];
+		for (i = 0; i < num; i++) {
+			if (gather[i].offset == child->offset)
+				break;
+		}
+		if (i == num &&
+		    child->offset + child->count * child->stride > src_bytes)
+			src_bytes = child->offset + child->count * child->stride;
+	}
 
-	return ctx->dest.offset;
+	if (ctx->src.size < src_bytes) {
+		ipct_err("ipct: error action 0x%x not enough packing space %zu need %d\n",
+			 ctx->id, ctx->src.size, src_bytes);
+		return -EINVAL;
+	}
+
+	size = pack_hdr_size(ctx->flags, ctx->addr) + action->plan_bytes;
+	if (size > ctx->dest.size) {
+		ipct_err("error: action 0x%x needs %d bytes buffer is %zu\n",
+			 ctx->id, size, ctx->dest.size);
+		return -ENOSPC;
+	}
+
+	init_header(ctx);
+
+	codec_pack_gather(action, ctx->dest.base + ctx->dest.offset,
+			  ctx->src.base, gather, num);
+	ctx->dest.offset += action->plan_bytes;
+
+	return complete_header(ctx, action->num_tuples, 0);
+}
+
+/*
+ * Compound messages - an action body too large for one message is sent as
+ * several chunks. Each chunk is a complete message holding whole top level
+ * tuples and elems.remaining counts down the chunks still to follow, so the
+ * receiver can unpack every chunk as it arrives.
+ */
+
+/* get the body offset of the end of the chunk starting at offset */
+static uint32_t chunk_end(const struct ipct_action *action, uint32_t offset,
+			  uint32_t space, uint32_t *tuples)
+{
+	const struct ipct_tuple *tuple;
+	uint32_t end = offset, size;
+
+	*tuples = 0;
+	while (end < action->plan_bytes) {
+		tuple = action->template + end;
+		size = IPCT_TUPLE_ALIGN(tuple_size(tuple));
+		if (end - offset + size > space)
+			break;
+
+		end += size;
+		(*tuples)++;
+	}
+
+	return end;
 }
 
-static int elem_pack(const struct ipct_tuple_elem *current,
-			const struct ipct_action_struct_desc *action,
-			struct ipct_msg_context *ctx)
+/**
+ * Split the action into chunks of at most stream->chunk_size bytes.
+ * Returns the number of chunks or a negative error code.
+ */
+int ipct_pack_stream_init(struct ipct_msg_context *ctx,
+			  struct ipct_msg_stream *stream)
 {
-	const struct ipct_tuple_elem *next;
-	struct ipct_tuple *cont_tuple;
-	uint32_t tuples = 0;
-	int cont = 0, size;
+	const struct ipct_action *action;
+	uint32_t hdr_size, offset, end, tuples, chunks = 0;
+
+	action = pack_get_action(ctx);
+	if (!action)
+		return -EINVAL;
 
-	while (current) {
+	/* blocks have no tuples to split on */
+	if (action_is_block(action)) {
+		ipct_err("error: block action 0x%x can't be streamed\n",
+			 ctx->id);
+		return -EINVAL;
+	}
 
-		/* Continuous ? */
-		if (cont) {
-			size = ipc_pack_cont(action, current, ctx, cont_tuple);
-		} else {
-			/* all new tuples are packed on word offset */
-			ctx->dest.offset += ctx->dest.offset % sizeof(uint32_t);
+	hdr_size = pack_hdr_size(ctx->flags, ctx->addr);
+	if (stream->chunk_size <= hdr_size) {
+		ipct_err("error: chunk size %zu too small\n", stream->chunk_size);
+		return -ENOSPC;
+	}
 
-			size = ipc_pack_single(action, current, ctx, &cont_tuple);
-		}
-		if (size <= 0) {
-			ipct_err("error: can't pack elem id %d type %d at 0x%x\n",
-					current->id, current->type, current->offset);
-			return size;
+	/* every chunk must hold at least one tuple */
+	for (offset = 0; offset < action->plan_bytes; offset = end) {
+		end = chunk_end(action, offset, stream->chunk_size - hdr_size,
+				&tuples);
+		if (end == offset) {
+			ipct_err("error: action 0x%x tuple at %d exceeds chunk size %zu\n",
+				 ctx->id, offset, stream->chunk_size);
+			return -ENOSPC;
 		}
+		chunks++;
+	}
 
-		/* get next elem - check continuous first */
-		next = continuous_elems(action, current);
-		if (next == NULL) {
-			/* new tuple */
-			cont = 0;
-			next = get_next_elem(action, current);
-			tuples++;
-		} else
-			cont = 1;
-
-		current = next;
-		ctx->dest.offset += size;
+	/* remaining is 8 bits */
+	if (chunks > IPCT_CHUNKS_MAX) {
+		ipct_err("error: action 0x%x needs %d chunks\n", ctx->id, chunks);
+		return -E2BIG;
 	}
 
-	return tuples;
+	stream->offset = 0;
+	stream->op = 0;
+	stream->remaining = chunks;
+	return chunks;
 }
 
 /**
- * Convert message from internal C struct to tuples.
+ * Pack the next chunk of the stream into ctx->dest.
+ * Returns the chunk size in bytes, 0 when all chunks are packed or a
+ * negative error code.
  */
-int ipct_pack(struct ipct_msg_context *ctx)
+int ipct_pack_chunk(struct ipct_msg_context *ctx,
+		    struct ipct_msg_stream *stream)
 {
-	const struct ipct_action_def *action_def;
-	const struct ipct_action_struct_desc *action;
-	const struct ipct_tuple_elem *current;
-	int tuples = 0;
+	const struct ipct_action *action;
+	uint32_t hdr_size, end, tuples;
 
-	ipct_log("pack: id 0x%x\n",ctx-> id);
+	if (!stream->remaining)
+		return 0;
 
-	/* validate ID - is it supported ? */
-	action_def = get_action_def(ctx->id);
-	if (!action_def) {
+	action = get_action(ctx->ipct, ctx->id);
+	if (!action) {
 		ipct_err("ipct: error can't find action 0x%x\n", ctx->id);
 		return -EINVAL;
 	}
-	action = action_def->desc;
 
-	ipct_log("pack: action size %d mandatory %d optional %d\n",
-		action->size, action->mandatory.count, action->optional.count);
-
-	/* has user provided enough space to pack from ? */
-	if (ctx->src.size < action->size) {
-		ipct_err("ipct: error action 0x%x not enough packing space %d need %ld\n",
-			ctx->id, action->size, ctx->src.size);
-		return -EINVAL;
+	hdr_size = pack_hdr_size(ctx->flags, ctx->addr);
+	end = chunk_end(action, stream->offset, stream->chunk_size - hdr_size,
+			&tuples);
+	if (end == stream->offset || hdr_size + end - stream->offset >
+	    ctx->dest.size) {
+		ipct_err("error: action 0x%x chunk needs %d bytes buffer is %zu\n",
+			 ctx->id, hdr_size + end - stream->offset,
+			 ctx->dest.size);
+		return -ENOSPC;
 	}
 
-	/* create header */
 	init_header(ctx);
 
-	/* process the action elem by elem - mandatory first */
-	current = get_first_elem(action);
-	if (!current) {
-		ipct_err("error: no elems to pack in 0x%x\n", ctx->id);
+	codec_pack_window(action, ctx->dest.base + ctx->dest.offset,
+			  ctx->src.base, stream->offset, end, &stream->op);
+	ctx->dest.offset += end - stream->offset;
+	stream->offset = end;
+	stream->remaining--;
+
+	return complete_header(ctx, tuples, stream->remaining);
+}
+
+/* copy bytes to message offset in the iovcnt segments - caller checked size */
+static void iov_write(const struct ipct_iovec *iov, int iovcnt,
+		      uint32_t offset, const void *data, uint32_t bytes)
+{
+	const struct ipct_iovec *end = iov + iovcnt;
+	uint32_t n;
+
+	/* nothing to write - offset can be the end of the segments */
+	if (!bytes)
+		return;
+
+	/* find the segment holding offset */
+	for (; iov < end && offset >= iov->len; iov++)
+		offset -= iov->len;
+
+	for (; iov < end && bytes; iov++, offset = 0) {
+		n = iov->len - offset < bytes ? iov->len - offset : bytes;
+		memcpy(iov->base + offset, data, n);
+		data += n;
+		bytes -= n;
+	}
+}
+
+/**
+ * Convert message from internal C struct to tuples written straight into
+ * the destination segments. Tuples can straddle segments.
+ */
+int ipct_pack_iov(struct ipct_msg_context *ctx, const struct ipct_iovec *iov,
+		  int iovcnt)
+{
+	const struct ipct_action *action;
+	uint32_t hdr_buf[IPCT_HDR_MAX_SIZE / sizeof(uint32_t)];
+	uint32_t hdr_size, size, pos, start, end, op = 0;
+	const uint32_t pad = 0;
+	size_t space = 0;
+	int i, ret;
+
+	action = pack_get_action(ctx);
+	if (!action)
 		return -EINVAL;
+
+	/* check: does the message fit in the segments ? */
+	for (i = 0; i < iovcnt; i++)
+		space += iov[i].len;
+	hdr_size = pack_hdr_size(ctx->flags, ctx->addr);
+	size = hdr_size + action->plan_bytes;
+	if (size > space) {
+		ipct_err("error: action 0x%x needs %d bytes segments are %zu\n",
+			 ctx->id, size, space);
+		return -ENOSPC;
 	}
 
-	tuples = elem_pack(current, action, ctx);
-	if (tuples < 0) {
-		ipct_err("error: failed to pack action 0x%x\n", ctx->id);
-		return tuples;
+	/* headers are small so build them locally */
+	ctx->dest.base = hdr_buf;
+	ctx->dest.offset = 0;
+	ctx->dest.size = sizeof(hdr_buf);
+	init_header(ctx);
+	ret = set_elems(ctx->dest.base, action->num_tuples, 0,
+			action->plan_bytes);
+	if (ret < 0)
+		return ret;
+
+	if (action_is_block(action)) {
+		((struct ipct_hdr *)ctx->dest.base)->block = 1;
+		iov_write(iov, iovcnt, 0, hdr_buf, hdr_size);
+		iov_write(iov, iovcnt, hdr_size, ctx->src.base,
+			  action->def->desc->size);
+		iov_write(iov, iovcnt, hdr_size + action->def->desc->size,
+			  &pad, action->plan_bytes - action->def->desc->size);
+		return size;
 	}
 
-	/* finished */
-	return complete_header(ctx, tuples);
+	iov_write(iov, iovcnt, 0, hdr_buf, hdr_size);
+
+	/* pack the body window in each segment */
+	for (pos = 0; pos < size; pos += iov->len, iov++) {
+		end = pos + iov->len < size ? pos + iov->len : size;
+		start = pos > hdr_size ? pos : hdr_size;
+		if (start >= end)
+			continue;
+
+		codec_pack_window(action, iov->base + start - pos,
+				  ctx->src.base, start - hdr_size,
+				  end - hdr_size, &op);
+	}
+
+	return size;
 }
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/** \brief
+ *  Parse the headers of received message src of src_size bytes into info.
+ *  Only the headers are read - the message body is not validated. Messages
+ *  without elems are sized as nano or micro messages from the block bit.
+ */
+int ipct_msg_peek(void *src, size_t src_size, struct ipct_msg_info *info)
+{
+	struct ipct_hdr *hdr = src;
+	uint32_t hdr_size;
+
+	if (src_size < sizeof(*hdr))
+		return -EINVAL;
+
+	/* check: headers are in src */
+	hdr_size = IPCT_HDR_GET_HDR_SIZE(hdr);
+	if (hdr_size > src_size) {
+		ipct_err("ipct: error action 0x%x headers exceed buffer\n",
+			 IPCT_HDR_GET_ID(hdr));
+		return -EINVAL;
+	}
+
+	info->id = IPCT_HDR_GET_ID(hdr);
+	info->flags = unpack_hdr_flags(hdr);
+	info->block = hdr->elems && hdr->block;
+	info->receiver = ipct_get_receiver(hdr);
+	info->sender = ipct_get_sender(hdr);
+	info->hdr_size = hdr_size;
+
+	if (!hdr->elems) {
+		info->num_tuples = 0;
+		info->remaining = 0;
+		info->size = msg_micro_size(hdr) - hdr_size;
+
+		/* check: micro tuple is in src */
+		if (hdr_size + info->size > src_size) {
+			ipct_err("ipct: error micro message 0x%x exceeds buffer\n",
+				 info->id);
+			return -EINVAL;
+		}
+		return 0;
+	}
+
+	info->num_tuples = ipct_get_tuples(hdr);
+	info->remaining = ipct_get_remaining(hdr);
+	info->size = ipct_get_size(hdr);
+
+	/* check: body is in src */
+	if (hdr_size + info->size > src_size) {
+		ipct_err("ipct: error action 0x%x size %d exceeds buffer\n",
+			 info->id, info->size);
+		return -EINVAL;
+	}
+
+	return 0;
+}
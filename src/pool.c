@@ -0,0 +1,315 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Message buffer pool.
+ *
+ * Buffers come in power of two size classes sized from the largest message
+ * of each action the pool is created for. Each class is a fixed array of
+ * buffers with a lock free free list. The list head holds the index of the
+ * first free buffer and a tag that changes on every update so a stale head
+ * can never be swapped back in (ABA). Get and put are O(1) and any thread
+ * can put a buffer back, so buffers are handed from packer to transport to
+ * receiver without copies.
+ */
+
+/* size classes are 2^IPCT_POOL_MIN_SHIFT bytes and up */
+#define IPCT_POOL_MIN_SHIFT	5
+#define IPCT_POOL_CLASSES	20
+
+/* buffer header - buffer data follows */
+struct pool_buf {
+	atomic_uint next;		/**< free list link - index + 1 */
+	atomic_uint refs;		/**< references held by clients */
+	uint32_t cls;			/**< size class */
+	uint32_t index;			/**< index in size class */
+};
+
+struct pool_class {
+	_Atomic uint64_t head;		/**< tag << 32 | free index + 1 */
+	void *base;			/**< first buffer header */
+	uint32_t stride;		/**< header and data bytes */
+	uint32_t count;
+};
+
+struct ipct_msg_pool {
+	struct pool_class cls[IPCT_POOL_CLASSES];
+	void *mem;
+	size_t mem_size;
+};
+
+/* smallest size class holding size bytes */
+static inline int pool_class_get(size_t size)
+{
+	int shift;
+
+	if (size <= 1 << IPCT_POOL_MIN_SHIFT)
+		return 0;
+
+	shift = 64 - __builtin_clzll(size - 1);
+	return shift - IPCT_POOL_MIN_SHIFT;
+}
+
+static inline struct pool_buf *pool_buf_get(const struct pool_class *cls,
+					    uint32_t index)
+{
+	return cls->base + index * cls->stride;
+}
+
+/* pop a buffer from the free list or NULL if class is empty */
+static struct pool_buf *pool_class_pop(struct pool_class *cls)
+{
+	struct pool_buf *buf;
+	uint64_t head, new;
+	uint32_t next;
+
+	head = atomic_load_explicit(&cls->head, memory_order_acquire);
+	do {
+		if (!(uint32_t)head)
+			return NULL;
+
+		/* next may be stale if buf was taken meanwhile - CAS fails */
+		buf = pool_buf_get(cls, (uint32_t)head - 1);
+		next = atomic_load_explicit(&buf->next, memory_order_relaxed);
+		new = ((head >> 32) + 1) << 32 | next;
+	} while (!atomic_compare_exchange_weak_explicit(&cls->head, &head, new,
+							memory_order_acquire,
+							memory_order_acquire));
+
+	return buf;
+}
+
+static void pool_class_push(struct pool_class *cls, struct pool_buf *buf)
+{
+	uint64_t head, new;
+
+	head = atomic_load_explicit(&cls->head, memory_order_relaxed);
+	do {
+		atomic_store_explicit(&buf->next, (uint32_t)head,
+				      memory_order_relaxed);
+		new = ((head >> 32) + 1) << 32 | (buf->index + 1);
+	} while (!atomic_compare_exchange_weak_explicit(&cls->head, &head, new,
+							memory_order_release,
+							memory_order_relaxed));
+}
+
+/** \brief
+ *  Create a pool with bufs buffers of each size class used by the largest
+ *  messages of the num_ids action IDs in ids.
+ */
+struct ipct_msg_pool *ipct_ctx_msg_pool_create(struct ipct_context *ipct,
+					       const uint32_t *ids, int num_ids,
+					       int bufs)
+{
+	struct ipct_msg_pool *pool;
+	struct pool_class *cls;
+	struct pool_buf *buf;
+	void *mem;
+	uint32_t j;
+	int i, size;
+
+	if (bufs <= 0)
+		return NULL;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	/* enable the size class of each action */
+	for (i = 0; i < num_ids; i++) {
+		size = ipct_ctx_msg_max_size(ipct, ids[i]);
+		if (size < 0 || pool_class_get(size) >= IPCT_POOL_CLASSES) {
+			ipct_err("error: no pool size class for action 0x%x\n",
+				 ids[i]);
+			goto err;
+		}
+
+		cls = &pool->cls[pool_class_get(size)];
+		if (cls->count)
+			continue;
+
+		cls->count = bufs;
+		cls->stride = sizeof(*buf) +
+			(1 << (pool_class_get(size) + IPCT_POOL_MIN_SHIFT));
+		pool->mem_size += (size_t)cls->count * cls->stride;
+	}
+
+	if (!pool->mem_size)
+		goto err;
+
+	pool->mem = malloc(pool->mem_size);
+	if (!pool->mem)
+		goto err;
+
+	/* carve the buffers and link each class free list */
+	mem = pool->mem;
+	for (i = 0; i < IPCT_POOL_CLASSES; i++) {
+		cls = &pool->cls[i];
+		cls->base = mem;
+		mem += (size_t)cls->count * cls->stride;
+
+		for (j = 0; j < cls->count; j++) {
+			buf = pool_buf_get(cls, j);
+			atomic_init(&buf->next, j + 1 < cls->count ? j + 2 : 0);
+			atomic_init(&buf->refs, 0);
+			buf->cls = i;
+			buf->index = j;
+		}
+		atomic_init(&cls->head, cls->count ? 1 : 0);
+	}
+
+	return pool;
+
+err:
+	free(pool);
+	return NULL;
+}
+
+/** \brief
+ *  Free the pool. Every buffer must have been put back.
+ */
+void ipct_msg_pool_destroy(struct ipct_msg_pool *pool)
+{
+	free(pool->mem);
+	free(pool);
+}
+
+/** \brief
+ *  Get a buffer of at least size bytes. The smallest free buffer is used so
+ *  a burst of small messages can borrow larger buffers. Returns NULL when
+ *  no buffer is free.
+ */
+void *ipct_msg_pool_get(struct ipct_msg_pool *pool, size_t size)
+{
+	struct pool_buf *buf;
+	int i;
+
+	for (i = pool_class_get(size); i < IPCT_POOL_CLASSES; i++) {
+		if (!pool->cls[i].count)
+			continue;
+
+		buf = pool_class_pop(&pool->cls[i]);
+		if (buf) {
+			atomic_store_explicit(&buf->refs, 1,
+					      memory_order_relaxed);
+			return buf + 1;
+		}
+	}
+
+	return NULL;
+}
+
+/* get the header of a pool buffer or NULL if data is not a pool buffer */
+static struct pool_buf *pool_buf_header(struct ipct_msg_pool *pool,
+					void *data)
+{
+	const struct pool_class *cls;
+	struct pool_buf *buf = data - sizeof(*buf);
+
+	if (data < pool->mem + sizeof(*buf) ||
+	    data >= pool->mem + pool->mem_size)
+		return NULL;
+
+	/* check: data is the start of a buffer */
+	if (buf->cls >= IPCT_POOL_CLASSES)
+		return NULL;
+	cls = &pool->cls[buf->cls];
+	if (buf->index >= cls->count ||
+	    (void *)buf != pool_buf_get(cls, buf->index))
+		return NULL;
+
+	return buf;
+}
+
+/** \brief
+ *  Take refs more references to a buffer, e.g. to hand it to several
+ *  receivers. Each reference is dropped with ipct_msg_pool_put().
+ */
+int ipct_msg_pool_ref(struct ipct_msg_pool *pool, void *data, int refs)
+{
+	struct pool_buf *buf;
+	unsigned int old;
+
+	if (refs < 0)
+		return -EINVAL;
+
+	buf = pool_buf_header(pool, data);
+	if (!buf) {
+		ipct_err("error: buffer %p not in pool\n", data);
+		return -EINVAL;
+	}
+
+	/* check: caller must hold a reference */
+	old = atomic_load_explicit(&buf->refs, memory_order_relaxed);
+	do {
+		if (!old) {
+			ipct_err("error: buffer %p is free\n", data);
+			return -EINVAL;
+		}
+	} while (!atomic_compare_exchange_weak_explicit(&buf->refs, &old,
+							old + refs,
+							memory_order_relaxed,
+							memory_order_relaxed));
+
+	return 0;
+}
+
+/** \brief
+ *  Drop a buffer reference. The buffer goes back in the pool when the last
+ *  reference is dropped and that can be from any thread.
+ */
+int ipct_msg_pool_put(struct ipct_msg_pool *pool, void *data)
+{
+	struct pool_buf *buf;
+	unsigned int old;
+
+	buf = pool_buf_header(pool, data);
+	if (!buf) {
+		ipct_err("error: buffer %p not in pool\n", data);
+		return -EINVAL;
+	}
+
+	/* check: a buffer can't be put back more times than it's referenced */
+	old = atomic_load_explicit(&buf->refs, memory_order_relaxed);
+	do {
+		if (!old) {
+			ipct_err("error: buffer %p is already free\n", data);
+			return -EINVAL;
+		}
+	} while (!atomic_compare_exchange_weak_explicit(&buf->refs, &old,
+							old - 1,
+							memory_order_acq_rel,
+							memory_order_relaxed));
+
+	if (old == 1)
+		pool_class_push(&pool->cls[buf->cls], buf);
+	return 0;
+}
+
+/** \brief
+ *  Get the size in bytes of pool buffer.
+ */
+size_t ipct_msg_pool_buf_size(struct ipct_msg_pool *pool, void *data)
+{
+	struct pool_buf *buf;
+
+	buf = pool_buf_header(pool, data);
+	if (!buf)
+		return 0;
+
+	return pool->cls[buf->cls].stride - sizeof(*buf);
+}
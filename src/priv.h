@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdatomic.h>
 
 #include <ipct/client.h>
 #include <ipct/builder.h>
@@ -20,6 +21,18 @@
 /* TODO: this is generated based on IPC definitions */
 #define IPCT_MAX_DEPTH		10
 
+/* number of klass, subklass and action IDs - each is 8 bits of the ID */
+#define IPCT_ID_COUNT		256
+
+/* largest message body - elems size is 24 bits of words */
+#define IPCT_BODY_MAX_BYTES	((1 << 24) * sizeof(uint32_t))
+
+/* chunks in a compound message - elems.remaining is 8 bits */
+#define IPCT_CHUNKS_MAX		256
+
+/* unused ID slots allowed in a dense tuple index before it is hashed */
+#define IPCT_INDEX_DENSE_SLACK	16
+
 /*
  * IPCT has message buffers.
  *
@@ -33,12 +46,8 @@ struct ipc_msg_buf {
 	size_t size;
 };
 
-struct ipct_context {
-
-	int dbb_loopback;
-};
-
 struct ipct_msg_context {
+	struct ipct_context *ipct;	/**< owning IPCT context */
 	uint32_t id;
 	uint32_t addr;
 	uint32_t flags;
@@ -46,6 +55,378 @@ struct ipct_msg_context {
 	struct ipc_msg_buf dest;
 };
 
+/*
+ * IPCT compiled action.
+ *
+ * Runtime data built once from an action definition when it's registered.
+ * The tuple index maps every tuple ID used by the action descriptor (and its
+ * subactions) to its elem number. It's a dense table over the used ID range
+ * or a collision free multiplicative hash when the IDs are sparse.
+ */
+struct ipct_elem_conv;
+
+/* index slot value for unused tuple IDs */
+#define IPCT_ELEM_NONE		0xffff
+
+/* C structs are numbered in descriptor order from the action struct */
+#define IPCT_DESC_ACTION	0
+#define IPCT_DESC_MAX		256
+
+/*
+ * Compiled elems of the action stored as separate narrow arrays indexed by
+ * elem number. Lookups only touch the arrays they need and the descriptor
+ * itself is not read when handling messages.
+ */
+struct ipct_elem_table {
+	uint16_t *id;			/**< first tuple ID */
+	uint16_t *count;		/**< tuple IDs used - C arrays use many */
+	uint8_t *desc;			/**< owning C struct number */
+	int16_t *mandatory;		/**< mandatory bit or -1 if optional */
+	struct ipct_elem_conv *conv;	/**< converter and offsets */
+	struct ipct_elem_limit *limit;	/**< value limits - checked elems only */
+	const struct ipct_tuple_elem **elem;	/**< source elem - cold */
+	uint32_t num;
+};
+
+/* top level mandatory elems are tracked in the reassembler sized bitmap */
+#define IPCT_MANDATORY_WORDS	IPCT_REASM_SEEN_WORDS
+#define IPCT_MANDATORY_MAX	(IPCT_MANDATORY_WORDS * 64)
+
+/*
+ * IPCT pack plan.
+ *
+ * The action elems sorted by tuple ID and grouped into runs of continuous IDs
+ * with the same tuple type. Each run is packed as a single tuple or tuple
+ * array so all tuple headers and sizes are known before packing starts.
+ */
+struct ipct_pack_run {
+	uint16_t id;		/**< tuple ID of first elem */
+	uint16_t type;		/**< enum ipct_tuple_elem_type */
+	uint16_t count;		/**< number of elems in run */
+	uint32_t data_size;	/**< data size of each elem in bytes */
+	uint32_t first;		/**< index of first elem in plan */
+	uint32_t bytes;		/**< tuple size in bytes including padding */
+};
+
+/*
+ * IPCT pack scope.
+ *
+ * The pack plan for one C structure descriptor. Each subaction is a child
+ * scope packed as a TUPLE_ARRAY tuple with one entry per C array element.
+ * Every entry has the same tuple layout and the array tuple ID is the lowest
+ * tuple ID used by the subaction.
+ */
+struct ipct_pack_scope {
+	const struct ipct_action_struct_desc *desc;
+	const struct ipct_tuple_elem **plan;	/**< elems sorted by tuple ID */
+	struct ipct_pack_run *runs;
+	uint32_t num_runs;
+	struct ipct_pack_scope *child;		/**< one per subaction */
+	uint32_t num_children;
+	uint32_t offset;	/**< array offset in parent C struct */
+	uint32_t stride;	/**< C size of each array element */
+	uint16_t count;		/**< number of array elements */
+	uint16_t key;		/**< TUPLE_ARRAY tuple ID */
+	uint8_t desc_num;	/**< C struct number of desc */
+	uint32_t bytes;		/**< packed size of one entry in bytes */
+	uint32_t num_ops;	/**< elems packed by one entry */
+	uint32_t num_checks;	/**< tuple header checks for one entry */
+	uint32_t pack_op;	/**< first pack op - top level subactions */
+};
+
+/*
+ * IPCT codec ops.
+ *
+ * The pack plan is lowered into flat lists of copy ops between C structure
+ * offsets and tuple data offsets in the message body (after the headers).
+ * Adjacent copies where the C and wire layouts line up are merged into a
+ * single op. Tuple headers and padding come from a prebuilt body template.
+ */
+enum ipct_op_type {
+	IPCT_OP_COPY		= 0,	/* copy bytes */
+	IPCT_OP_ZERO		= 1,	/* zero C bytes - unpack only */
+	IPCT_OP_UINT8		= 2,	/* uint8_t C data in 16 bit tuple data */
+	IPCT_OP_INT8		= 3,	/* int8_t C data in 16 bit tuple data */
+};
+
+enum ipct_op_check {
+	IPCT_CHECK_NONE		= 0,
+	IPCT_CHECK_UINT		= 1,	/* unsigned min..max */
+	IPCT_CHECK_INT		= 2,	/* signed min..max */
+	IPCT_CHECK_FLOAT	= 3,	/* float min..max */
+	IPCT_CHECK_DOUBLE	= 4,	/* double min..max */
+	IPCT_CHECK_MASK		= 5,	/* only bits in max are valid */
+};
+
+union ipct_op_limit {
+	uint64_t u;
+	int64_t i;
+	double d;
+};
+
+struct ipct_codec_op {
+	uint8_t type;			/**< enum ipct_op_type */
+	uint8_t check;			/**< enum ipct_op_check - unpack only */
+	uint16_t id;			/**< tuple ID of first elem */
+	uint32_t size;			/**< tuple data bytes of each elem */
+	uint32_t bytes;			/**< tuple data bytes of all elems */
+	uint32_t c_offset;		/**< offset in C struct */
+	uint32_t wire_offset;		/**< offset in message body */
+	union ipct_op_limit min;
+	union ipct_op_limit max;
+};
+
+/* elem value limits - only read for elems with a value check */
+struct ipct_elem_limit {
+	union ipct_op_limit min;
+	union ipct_op_limit max;
+};
+
+/* how a tuple data elem is copied to its C struct member */
+enum ipct_conv_type {
+	IPCT_CONV_8		= 0,	/* 16 bit tuple data to 8 bit C data */
+	IPCT_CONV_16		= 1,
+	IPCT_CONV_32		= 2,
+	IPCT_CONV_64		= 3,
+	IPCT_CONV_BYTES		= 4,	/* copy_bytes then zero the rest */
+};
+
+/*
+ * Elem converter - resolved from the tuple elem when the action is built so
+ * unpacking a tuple by tuple message does not go back to the descriptor.
+ * Only what the verify and copy passes read is kept here.
+ */
+struct ipct_elem_conv {
+	uint32_t c_offset;		/**< offset in C struct */
+	uint32_t c_size;		/**< C member bytes of each elem */
+	uint32_t data_size;		/**< tuple data bytes of each elem */
+	uint32_t copy_bytes;		/**< bytes copied, rest is zeroed */
+	uint8_t type;			/**< enum ipct_conv_type */
+	uint8_t check;			/**< enum ipct_op_check */
+};
+
+_Static_assert(sizeof(struct ipct_elem_conv) <= 24,
+	       "elem converter must stay small");
+
+/* expected tuple header word in body - the unpack fast path must match all */
+struct ipct_tuple_check {
+	uint32_t offset;		/**< tuple offset in message body */
+	uint32_t value;
+	uint32_t mask;
+};
+
+struct ipct_action {
+	const struct ipct_action_def *def;
+
+	/* codec */
+	void *template;			/**< packed body with data zeroed */
+	struct ipct_tuple_check *tuple_checks;
+	uint32_t num_checks;
+	struct ipct_codec_op *pack_ops;
+	uint32_t num_pack_ops;
+	struct ipct_codec_op *unpack_ops;
+	uint32_t num_unpack_ops;
+	uint32_t *view_offsets;		/**< packed data offset per index slot */
+	uint32_t src_bytes;		/**< C bytes read by top level elems */
+
+	/* pack plan */
+	struct ipct_pack_scope scope;	/**< top level C struct */
+	uint32_t num_tuples;		/**< top level tuples in message */
+	uint32_t plan_bytes;		/**< packed size of all tuples in bytes */
+
+	/* mandatory elems - bit per elem in desc->mandatory order */
+	uint64_t mandatory_mask[IPCT_MANDATORY_WORDS];
+	uint32_t mandatory_words;	/**< words used in mask */
+
+	/* compiled elems */
+	struct ipct_elem_table elems;
+	const struct ipct_action_struct_desc **descs;	/**< by C struct number */
+	uint32_t num_descs;
+
+	/* tuple ID index */
+	uint16_t *index;		/**< elem number per slot */
+	uint32_t index_size;		/**< number of index slots */
+	uint32_t hash_seed;		/**< hash multiplier or 0 for dense */
+	uint32_t hash_shift;		/**< hash slot shift */
+	uint32_t num_ids;		/**< number of tuple IDs in index */
+	uint16_t min_id;		/**< lowest tuple ID */
+	uint16_t max_id;		/**< highest tuple ID */
+};
+
+/* is action sent as a private data block ? */
+static inline int action_is_block(const struct ipct_action *action)
+{
+	return action->def->flags & IPCT_ACTION_FLAG_BLOCK;
+}
+
+static inline uint32_t action_index_slot(const struct ipct_action *action,
+					 uint32_t id)
+{
+	if (action->hash_seed)
+		return (id * action->hash_seed) >> action->hash_shift;
+
+	/* IDs below min_id wrap and fail the size check */
+	return id - action->min_id;
+}
+
+/* get the elem number for tuple ID or -1 */
+static inline int action_get_elem(const struct ipct_action *action,
+				  uint32_t id)
+{
+	uint32_t slot = action_index_slot(action, id);
+	int elem;
+
+	if (slot >= action->index_size)
+		return -1;
+
+	/* C array elems own a range of IDs */
+	elem = action->index[slot];
+	if (elem == IPCT_ELEM_NONE ||
+	    id - action->elems.id[elem] >= action->elems.count[elem])
+		return -1;
+
+	return elem;
+}
+
+/* mark mandatory elem as received */
+static inline void mandatory_set(uint64_t *seen,
+				 const struct ipct_elem_table *elems, int elem)
+{
+	int bit = elems->mandatory[elem];
+
+	if (bit >= 0)
+		seen[bit / 64] |= 1ULL << (bit % 64);
+}
+
+/* have all mandatory elems been received ? */
+static inline int action_mandatory_check(const struct ipct_action *action,
+					 const uint64_t *seen)
+{
+	const struct ipct_tuple_elem *elem;
+	uint64_t missing;
+	uint32_t i;
+
+	for (i = 0; i < action->mandatory_words; i++) {
+		missing = action->mandatory_mask[i] & ~seen[i];
+		if (missing) {
+			elem = &action->def->desc->mandatory.elem[i * 64 +
+						__builtin_ctzll(missing)];
+			ipct_err("error: mandatory tuple id %d missing\n",
+				 elem->id);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * IPCT registry.
+ *
+ * Direct index lookup tables compiled from the feature klasses. Each level
+ * is indexed by the klass, subklass or action field of the ID and is only
+ * as large as the highest ID used at that level, so resolving an ID costs
+ * a fixed number of loads regardless of how many features are registered.
+ *
+ * Klass tables are immutable once published. Readers never lock, they only
+ * mark a read section in one of two epoch counters. Unregister unpublishes
+ * the klass, flips the epoch and waits for readers of the old epoch to
+ * leave before the klass tables are freed.
+ */
+struct ipct_action_table {
+	uint32_t num_actions;		/**< highest action ID + 1 */
+	struct ipct_action *action[];
+};
+
+struct ipct_klass_table {
+	uint32_t num_subklasses;	/**< highest subklass ID + 1 */
+	struct ipct_action_table *subklass[];
+};
+
+struct ipct_registry {
+	struct ipct_klass_table *_Atomic klass[IPCT_ID_COUNT];
+
+	/* read sections */
+	atomic_uint epoch;
+	atomic_uint readers[2];		/**< active readers per epoch parity */
+	atomic_flag writer;		/**< serializes register and unregister */
+};
+
+/* enter a lock free read section - returns the epoch to pass to unlock */
+static inline uint32_t registry_read_lock(struct ipct_registry *reg)
+{
+	uint32_t epoch;
+
+	for (;;) {
+		epoch = atomic_load(&reg->epoch);
+		atomic_fetch_add(&reg->readers[epoch & 1], 1);
+
+		/* epoch flipped before we were counted ? - retry */
+		if (atomic_load(&reg->epoch) == epoch)
+			return epoch;
+
+		atomic_fetch_sub(&reg->readers[epoch & 1], 1);
+	}
+}
+
+static inline void registry_read_unlock(struct ipct_registry *reg,
+					uint32_t epoch)
+{
+	atomic_fetch_sub_explicit(&reg->readers[epoch & 1], 1,
+				  memory_order_release);
+}
+
+/* must be called in a read section */
+static inline const struct ipct_action *
+registry_get_action(const struct ipct_registry *reg, uint32_t id)
+{
+	const struct ipct_klass_table *klass;
+	const struct ipct_action_table *table;
+	uint32_t id_subklass = IPCT_ID_GET_SUBKLASS(id);
+	uint32_t id_action = IPCT_ID_GET_ACTION(id);
+
+	klass = atomic_load_explicit(&reg->klass[IPCT_ID_GET_KLASS(id)],
+				     memory_order_acquire);
+	if (!klass || id_subklass >= klass->num_subklasses)
+		return NULL;
+
+	table = klass->subklass[id_subklass];
+	if (!table || id_action >= table->num_actions)
+		return NULL;
+
+	return table->action[id_action];
+}
+
+/* does ipct_pack() add a route header for flags and dest_addr ? */
+static inline int pack_has_route(uint32_t flags, uint32_t addr)
+{
+	return addr || (flags & (IPCT_FLAGS_ROUTE | IPCT_FLAGS_BROADCAST));
+}
+
+/* set the header status, priority and datagram bits from flags */
+static inline void pack_hdr_flags(struct ipct_hdr *hdr, uint32_t flags)
+{
+	hdr->status = !!(flags & IPCT_FLAGS_REPLY_NACK);
+	hdr->priority = !!(flags & IPCT_FLAGS_PRIORTY);
+	hdr->datagram = !!(flags & IPCT_FLAGS_DATAGRAM);
+}
+
+/*
+ * Size of a message without elems - micro messages have the block bit set
+ * and are followed by a micro tuple, nano messages are the header only.
+ */
+static inline uint32_t msg_micro_size(const struct ipct_hdr *hdr)
+{
+	return hdr->block ? IPCT_MSG_MICRO_SIZE : IPCT_MSG_NANO_SIZE;
+}
+
+/* size of the headers ipct_pack() creates for flags and dest_addr */
+static inline uint32_t pack_hdr_size(uint32_t flags, uint32_t addr)
+{
+	return sizeof(struct ipct_hdr) + sizeof(struct sof_ipct_elems) +
+		(pack_has_route(flags, addr) ? sizeof(struct sof_ipct_route) : 0);
+}
+
 static inline int is_ptr_valid(struct ipc_msg_buf *buf, void *ptr)
 {
 	/* check: ptr is within buffer */
@@ -58,20 +439,78 @@ static inline int is_ptr_valid(struct ipc_msg_buf *buf, void *ptr)
 	return 1;
 }
 
-const struct ipct_action_def *get_action(const struct ipct_subklass_def *subklass,
-						uint32_t id);
+void registry_init(struct ipct_registry *reg);
+int registry_add(struct ipct_registry *reg, const struct ipct_klass_def *klass);
+int registry_add_list(struct ipct_registry *reg,
+		      const struct ipct_klass_list *list);
+int registry_remove(struct ipct_registry *reg, uint32_t klass_id);
+void registry_free(struct ipct_registry *reg);
+
+struct ipct_action *action_build(const struct ipct_action_def *def);
+void action_free(struct ipct_action *action);
 
-const struct ipct_subklass_def *get_subklass(const struct ipct_klass_def *klass,
-						    uint32_t id);
+/* message counters - see struct ipct_ctx_stats */
+struct ipct_context_stats {
+	atomic_ullong msgs_packed;
+	atomic_ullong msgs_unpacked;
+	atomic_ullong bytes_packed;
+	atomic_ullong bytes_unpacked;
+	atomic_ullong pack_errors;
+	atomic_ullong unpack_errors;
+};
 
-const struct ipct_klass_def *get_klass(uint32_t id);
+/*
+ * IPCT context - everything a peer endpoint needs. Nothing is shared
+ * between contexts.
+ */
+struct ipct_context {
+	struct ipct_registry registry;
+	struct ipct_context_stats stats;
+	uint32_t addr;			/**< sender address for routed messages */
 
-const struct ipct_action_def *get_action_def(uint32_t id);
+	int dbb_loopback;
+};
 
-const struct ipct_tuple_elem *get_tuple_elem(const struct ipct_action_struct_desc *desc,
-					     const struct ipct_tuple *tuple, int index, int depth);
+void context_init(struct ipct_context *ipct);
+const struct ipct_action *get_action(struct ipct_context *ipct, uint32_t id);
 
 int ipct_pack(struct ipct_msg_context *ctx);
 int ipct_unpack(struct ipct_msg_context *ctx);
+int ipct_pack_iov(struct ipct_msg_context *ctx, const struct ipct_iovec *iov,
+		  int iovcnt);
+int ipct_pack_gather(struct ipct_msg_context *ctx,
+		     const struct ipct_gather *gather, int count);
+int ipct_pack_stream_init(struct ipct_msg_context *ctx,
+			  struct ipct_msg_stream *stream);
+int ipct_pack_chunk(struct ipct_msg_context *ctx,
+		    struct ipct_msg_stream *stream);
+int ipct_unpack_chunk(struct ipct_msg_context *ctx,
+		      struct ipct_msg_reasm *reasm);
+int unpack_hdr_check(struct ipct_hdr *hdr, size_t src_size, uint32_t *size,
+		     uint32_t *num_tuples);
+uint32_t unpack_hdr_flags(struct ipct_hdr *hdr);
+
+void elem_op_check(const struct ipct_tuple_elem *elem,
+		   struct ipct_codec_op *op);
+
+void codec_pack(const struct ipct_action *action, void *body, const void *src);
+void codec_pack_gather(const struct ipct_action *action, void *body,
+		       const void *src, const struct ipct_gather *gather,
+		       uint32_t count);
+void codec_pack_window(const struct ipct_action *action, void *body,
+		       const void *src, uint32_t start, uint32_t end,
+		       uint32_t *op);
+int codec_check(const struct ipct_action *action, const void *body,
+		uint32_t size, uint32_t tuples);
+void codec_conv_build(struct ipct_elem_conv *conv,
+		      struct ipct_elem_limit *limit,
+		      const struct ipct_tuple_elem *elem);
+int codec_conv_valid(const struct ipct_elem_conv *conv,
+		     const struct ipct_elem_limit *limit, uint32_t id,
+		     const void *data);
+void codec_conv_copy(const struct ipct_elem_conv *conv, void *dest,
+		     const void *data);
+int codec_unpack(const struct ipct_action *action, void *dest,
+		 const void *body, uint32_t size, uint32_t tuples);
 
 #endif
@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Priority receive queue.
+ *
+ * Each hdr.priority level has a bounded ring of message buffers. A ring
+ * cell sequence number tells producers and the consumer whose turn it is
+ * to use the cell, so any thread can put messages without a lock. The
+ * consumer takes high priority messages first but after burst high
+ * priority messages in a row a waiting normal message is taken, so normal
+ * messages are delayed but never starved.
+ */
+
+#define IPCT_QUEUE_NORMAL	0
+#define IPCT_QUEUE_HIGH		1
+#define IPCT_QUEUE_LEVELS	2
+
+struct queue_cell {
+	atomic_size_t seq;		/**< cell turn - see queue_ring_put() */
+	void *msg;
+	size_t size;
+};
+
+struct queue_ring {
+	atomic_size_t head;		/**< next cell to put */
+	atomic_size_t tail;		/**< next cell to get */
+	size_t mask;
+	struct queue_cell *cell;
+};
+
+struct ipct_msg_queue {
+	struct queue_ring ring[IPCT_QUEUE_LEVELS];
+	uint32_t burst;			/**< max high priority run */
+	uint32_t run;			/**< high priority run - consumer only */
+};
+
+static int queue_ring_put(struct queue_ring *ring, void *msg, size_t size)
+{
+	struct queue_cell *cell;
+	size_t pos, seq;
+
+	pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	for (;;) {
+		cell = &ring->cell[pos & ring->mask];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+		/* cell is free at pos - claim it */
+		if (seq == pos) {
+			if (atomic_compare_exchange_weak_explicit(&ring->head,
+								  &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed))
+				break;
+		} else if ((intptr_t)(seq - pos) < 0) {
+			/* cell still holds a message from the last lap */
+			return -ENOSPC;
+		} else {
+			pos = atomic_load_explicit(&ring->head,
+						   memory_order_relaxed);
+		}
+	}
+
+	cell->msg = msg;
+	cell->size = size;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	return 0;
+}
+
+static int queue_ring_get(struct queue_ring *ring, void **msg, size_t *size)
+{
+	struct queue_cell *cell;
+	size_t pos, seq;
+
+	pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	for (;;) {
+		cell = &ring->cell[pos & ring->mask];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+		/* cell holds the message at pos - take it */
+		if (seq == pos + 1) {
+			if (atomic_compare_exchange_weak_explicit(&ring->tail,
+								  &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed))
+				break;
+		} else if ((intptr_t)(seq - (pos + 1)) < 0) {
+			/* empty */
+			return 0;
+		} else {
+			pos = atomic_load_explicit(&ring->tail,
+						   memory_order_relaxed);
+		}
+	}
+
+	*msg = cell->msg;
+	*size = cell->size;
+
+	/* free the cell for the next lap */
+	atomic_store_explicit(&cell->seq, pos + ring->mask + 1,
+			      memory_order_release);
+	return 1;
+}
+
+/** \brief
+ *  Create a receive queue holding at least depth messages of each priority.
+ *  A waiting normal priority message is taken after at most burst high
+ *  priority messages.
+ */
+struct ipct_msg_queue *ipct_msg_queue_create(int depth, int burst)
+{
+	struct ipct_msg_queue *queue;
+	struct queue_ring *ring;
+	size_t cells = 1, i;
+	int level;
+
+	if (depth <= 0 || burst <= 0)
+		return NULL;
+
+	/* rings are a power of two for the cell mask */
+	while (cells < depth)
+		cells <<= 1;
+
+	queue = calloc(1, sizeof(*queue));
+	if (!queue)
+		return NULL;
+
+	queue->burst = burst;
+
+	for (level = 0; level < IPCT_QUEUE_LEVELS; level++) {
+		ring = &queue->ring[level];
+		ring->cell = calloc(cells, sizeof(*ring->cell));
+		if (!ring->cell)
+			goto err;
+
+		ring->mask = cells - 1;
+		atomic_init(&ring->head, 0);
+		atomic_init(&ring->tail, 0);
+		for (i = 0; i < cells; i++)
+			atomic_init(&ring->cell[i].seq, i);
+	}
+
+	return queue;
+
+err:
+	ipct_msg_queue_free(queue);
+	return NULL;
+}
+
+/** \brief
+ *  Free the queue. Any queued messages are not freed.
+ */
+void ipct_msg_queue_free(struct ipct_msg_queue *queue)
+{
+	int level;
+
+	for (level = 0; level < IPCT_QUEUE_LEVELS; level++)
+		free(queue->ring[level].cell);
+	free(queue);
+}
+
+/** \brief
+ *  Queue received message msg of size bytes by its header priority. Can be
+ *  called from any thread. Returns -ENOSPC if the priority level is full.
+ */
+int ipct_msg_queue_put(struct ipct_msg_queue *queue, void *msg, size_t size)
+{
+	struct ipct_msg_info info;
+	int ret;
+
+	ret = ipct_msg_peek(msg, size, &info);
+	if (ret < 0)
+		return ret;
+
+	return queue_ring_put(&queue->ring[info.flags & IPCT_FLAGS_PRIORTY ?
+					   IPCT_QUEUE_HIGH : IPCT_QUEUE_NORMAL],
+			      msg, size);
+}
+
+/** \brief
+ *  Get the next message to handle. Only one thread can get messages.
+ *  Returns 1 with the message and its size or 0 if the queue is empty.
+ */
+int ipct_msg_queue_get(struct ipct_msg_queue *queue, void **msg, size_t *size)
+{
+	/* high priority run is over - let a normal message through */
+	if (queue->run >= queue->burst &&
+	    queue_ring_get(&queue->ring[IPCT_QUEUE_NORMAL], msg, size)) {
+		queue->run = 0;
+		return 1;
+	}
+
+	if (queue_ring_get(&queue->ring[IPCT_QUEUE_HIGH], msg, size)) {
+		queue->run++;
+		return 1;
+	}
+
+	queue->run = 0;
+	return queue_ring_get(&queue->ring[IPCT_QUEUE_NORMAL], msg, size);
+}
@@ -0,0 +1,246 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+static void action_table_free(struct ipct_action_table *table)
+{
+	int i;
+
+	for (i = 0; i < table->num_actions; i++) {
+		if (table->action[i])
+			action_free(table->action[i]);
+	}
+	free(table);
+}
+
+/* create the action table for a subklass - indexed by action ID */
+static struct ipct_action_table *action_table_build(const struct ipct_subklass_def *subklass)
+{
+	const struct ipct_action_def *action;
+	struct ipct_action_table *table;
+	uint32_t num_actions = 0;
+	int i;
+
+	/* table only needs to cover the highest action ID */
+	for (i = 0; i < subklass->num_actions; i++) {
+		action = &subklass->actions[i];
+		if (action->action_id >= IPCT_ID_COUNT) {
+			ipct_err("error: action ID 0x%x out of range\n",
+				 action->action_id);
+			return NULL;
+		}
+		if (action->action_id >= num_actions)
+			num_actions = action->action_id + 1;
+	}
+
+	table = calloc(1, sizeof(*table) + num_actions * sizeof(table->action[0]));
+	if (!table)
+		return NULL;
+	table->num_actions = num_actions;
+
+	for (i = 0; i < subklass->num_actions; i++) {
+		action = &subklass->actions[i];
+		if (table->action[action->action_id]) {
+			ipct_err("error: duplicate action 0x%x in subklass 0x%x\n",
+				 action->action_id, subklass->subclass_id);
+			action_table_free(table);
+			return NULL;
+		}
+		table->action[action->action_id] = action_build(action);
+		if (!table->action[action->action_id]) {
+			action_table_free(table);
+			return NULL;
+		}
+	}
+
+	return table;
+}
+
+static void klass_table_free(struct ipct_klass_table *table)
+{
+	int i;
+
+	for (i = 0; i < table->num_subklasses; i++) {
+		if (table->subklass[i])
+			action_table_free(table->subklass[i]);
+	}
+	free(table);
+}
+
+/* create the subklass table for a klass - indexed by subklass ID */
+static struct ipct_klass_table *klass_table_build(const struct ipct_klass_def *klass)
+{
+	const struct ipct_subklass_def *subklass;
+	struct ipct_klass_table *table;
+	uint32_t num_subklasses = 0;
+	int i;
+
+	/* table only needs to cover the highest subklass ID */
+	for (i = 0; i < klass->num_subklasses; i++) {
+		subklass = &klass->subklass[i];
+		if (subklass->subclass_id >= IPCT_ID_COUNT) {
+			ipct_err("error: subklass ID 0x%x out of range\n",
+				 subklass->subclass_id);
+			return NULL;
+		}
+		if (subklass->subclass_id >= num_subklasses)
+			num_subklasses = subklass->subclass_id + 1;
+	}
+
+	table = calloc(1, sizeof(*table) +
+		       num_subklasses * sizeof(table->subklass[0]));
+	if (!table)
+		return NULL;
+	table->num_subklasses = num_subklasses;
+
+	for (i = 0; i < klass->num_subklasses; i++) {
+		subklass = &klass->subklass[i];
+		if (table->subklass[subklass->subclass_id]) {
+			ipct_err("error: duplicate subklass 0x%x in klass 0x%x\n",
+				 subklass->subclass_id, klass->klass_id);
+			goto err;
+		}
+
+		table->subklass[subklass->subclass_id] = action_table_build(subklass);
+		if (!table->subklass[subklass->subclass_id])
+			goto err;
+	}
+
+	return table;
+
+err:
+	klass_table_free(table);
+	return NULL;
+}
+
+static void registry_writer_lock(struct ipct_registry *reg)
+{
+	while (atomic_flag_test_and_set_explicit(&reg->writer,
+						 memory_order_acquire))
+		;
+}
+
+static void registry_writer_unlock(struct ipct_registry *reg)
+{
+	atomic_flag_clear_explicit(&reg->writer, memory_order_release);
+}
+
+/* wait for all readers that can still see unpublished klasses */
+static void registry_synchronize(struct ipct_registry *reg)
+{
+	uint32_t epoch = atomic_fetch_add(&reg->epoch, 1);
+
+	/* new readers use the other counter */
+	while (atomic_load(&reg->readers[epoch & 1]))
+		;
+}
+
+void registry_init(struct ipct_registry *reg)
+{
+	int i;
+
+	for (i = 0; i < IPCT_ID_COUNT; i++)
+		atomic_init(&reg->klass[i], NULL);
+	atomic_init(&reg->epoch, 0);
+	atomic_init(&reg->readers[0], 0);
+	atomic_init(&reg->readers[1], 0);
+	atomic_flag_clear(&reg->writer);
+}
+
+/**
+ * Compile a feature klass into lookup tables and publish it. Readers see
+ * either nothing or the complete klass.
+ */
+int registry_add(struct ipct_registry *reg, const struct ipct_klass_def *klass)
+{
+	struct ipct_klass_table *table;
+	struct ipct_klass_table *empty = NULL;
+
+	if (klass->klass_id >= IPCT_ID_COUNT) {
+		ipct_err("error: klass ID 0x%x out of range\n", klass->klass_id);
+		return -EINVAL;
+	}
+
+	/* compile outside the writer lock */
+	table = klass_table_build(klass);
+	if (!table)
+		return -EINVAL;
+
+	registry_writer_lock(reg);
+	if (!atomic_compare_exchange_strong(&reg->klass[klass->klass_id],
+					    &empty, table)) {
+		registry_writer_unlock(reg);
+		ipct_err("error: duplicate klass 0x%x\n", klass->klass_id);
+		klass_table_free(table);
+		return -EEXIST;
+	}
+	registry_writer_unlock(reg);
+
+	return 0;
+}
+
+/**
+ * Add every klass in a feature klass list.
+ */
+int registry_add_list(struct ipct_registry *reg,
+		      const struct ipct_klass_list *list)
+{
+	int i, ret;
+
+	for (i = 0; i < list->num_klasses; i++) {
+		ret = registry_add(reg, &list->klasses[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Unpublish a klass and free its tables once no reader can use them. Must
+ * not be called from a read section.
+ */
+int registry_remove(struct ipct_registry *reg, uint32_t klass_id)
+{
+	struct ipct_klass_table *table;
+
+	if (klass_id >= IPCT_ID_COUNT)
+		return -EINVAL;
+
+	registry_writer_lock(reg);
+	table = atomic_exchange(&reg->klass[klass_id], NULL);
+	if (table)
+		registry_synchronize(reg);
+	registry_writer_unlock(reg);
+
+	if (!table)
+		return -ENOENT;
+
+	klass_table_free(table);
+	return 0;
+}
+
+/* free all klasses - caller makes sure there are no readers */
+void registry_free(struct ipct_registry *reg)
+{
+	struct ipct_klass_table *table;
+	int i;
+
+	for (i = 0; i < IPCT_ID_COUNT; i++) {
+		table = atomic_exchange(&reg->klass[i], NULL);
+		if (table)
+			klass_table_free(table);
+	}
+}
@@ -0,0 +1,187 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Message relay.
+ *
+ * Routed messages are forwarded to the port of their receiver address
+ * without touching the body. Only the route header is rewritten in place,
+ * with the relay as sender and the port next hop as receiver, so the same
+ * pool buffer goes from the incoming to the outgoing transport.
+ * Broadcasts go to every port but the one of the sender, each port getting
+ * its own buffer reference. The port table is fixed when the relay is
+ * created so forwarding takes no lock.
+ */
+
+struct ipct_relay {
+	struct ipct_msg_pool *pool;
+	uint32_t addr;			/**< relay address - 0 keeps sender */
+	int num_ports;
+	struct ipct_relay_port port[];
+};
+
+/* get the index of the port for addr in the first num ports or -1 */
+static int relay_port_find(const struct ipct_relay_port *ports, int num,
+			   uint32_t addr)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (ports[i].addr == addr)
+			return i;
+	}
+
+	return -1;
+}
+
+/** \brief
+ *  Create a relay forwarding pool buffers to num_ports ports. Forwarded
+ *  messages get addr as sender unless addr is 0.
+ */
+struct ipct_relay *ipct_relay_create(struct ipct_msg_pool *pool, uint32_t addr,
+				     const struct ipct_relay_port *ports,
+				     int num_ports)
+{
+	struct ipct_relay *relay;
+	int i;
+
+	if (!pool || num_ports <= 0)
+		return NULL;
+
+	/* check: ports are unique and can't be broadcast */
+	for (i = 0; i < num_ports; i++) {
+		if (!ports[i].send ||
+		    ports[i].addr == SOF_IPCT_ROUTE_BROADCAST ||
+		    relay_port_find(ports, i, ports[i].addr) >= 0) {
+			ipct_err("error: bad relay port %d addr 0x%x\n", i,
+				 ports[i].addr);
+			return NULL;
+		}
+	}
+
+	relay = malloc(sizeof(*relay) + num_ports * sizeof(*ports));
+	if (!relay)
+		return NULL;
+
+	relay->pool = pool;
+	relay->addr = addr;
+	relay->num_ports = num_ports;
+	memcpy(relay->port, ports, num_ports * sizeof(*ports));
+
+	return relay;
+}
+
+void ipct_relay_free(struct ipct_relay *relay)
+{
+	free(relay);
+}
+
+/* send a buffer reference to port - the reference is dropped on failure */
+static int relay_send(struct ipct_relay *relay,
+		      const struct ipct_relay_port *port, void *msg,
+		      size_t size)
+{
+	int ret;
+
+	ret = port->send(port->arg, msg, size);
+	if (ret < 0) {
+		ipct_err("error: relay port 0x%x send failed %d\n", port->addr,
+			 ret);
+		ipct_msg_pool_put(relay->pool, msg);
+	}
+
+	return ret;
+}
+
+/** \brief
+ *  Forward routed message msg of size bytes. msg must be a buffer from the
+ *  relay pool and the caller reference is always consumed. Returns the
+ *  number of ports the message was sent to or a negative error code.
+ */
+int ipct_relay_forward(struct ipct_relay *relay, void *msg, size_t size)
+{
+	struct ipct_hdr *hdr = msg;
+	struct sof_ipct_route *route;
+	struct ipct_msg_info info;
+	int i, port, targets = 0, sent = 0, ret;
+
+	ret = ipct_msg_peek(msg, size, &info);
+	if (ret < 0)
+		goto err;
+
+	route = IPCT_HDR_GET_ROUTE_PTR(hdr);
+	if (!route) {
+		ipct_err("error: relay message 0x%x is not routed\n", info.id);
+		ret = -EINVAL;
+		goto err;
+	}
+
+	size = info.hdr_size + info.size;
+
+	/* unicast - buffer moves to the receiver port */
+	if (info.receiver != SOF_IPCT_ROUTE_BROADCAST) {
+		port = relay_port_find(relay->port, relay->num_ports,
+				       info.receiver);
+		if (port < 0) {
+			ipct_err("error: relay has no port for 0x%x\n",
+				 info.receiver);
+			ret = -EINVAL;
+			goto err;
+		}
+
+		/* the message is only rewritten once it can be sent */
+		if (relay->addr)
+			route->sender = relay->addr;
+		if (relay->port[port].next_addr)
+			route->receiver = relay->port[port].next_addr;
+
+		ret = relay_send(relay, &relay->port[port], msg, size);
+		return ret < 0 ? ret : 1;
+	}
+
+	/* broadcast - one reference for each port but the sender */
+	for (i = 0; i < relay->num_ports; i++) {
+		if (relay->port[i].addr != info.sender)
+			targets++;
+	}
+
+	if (!targets) {
+		ipct_msg_pool_put(relay->pool, msg);
+		return 0;
+	}
+
+	/* take every reference before a receiver can drop its own */
+	ret = ipct_msg_pool_ref(relay->pool, msg, targets - 1);
+	if (ret < 0)
+		goto err;
+
+	if (relay->addr)
+		route->sender = relay->addr;
+
+	for (i = 0; i < relay->num_ports; i++) {
+		if (relay->port[i].addr == info.sender)
+			continue;
+		if (relay_send(relay, &relay->port[i], msg, size) >= 0)
+			sent++;
+	}
+
+	return sent;
+
+err:
+	ipct_msg_pool_put(relay->pool, msg);
+	return ret;
+}
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include <ipct/client.h>
@@ -15,441 +16,244 @@
 #include "priv.h"
 
 /*
- * Data extractors - gets data from C ctx->src.bases.
+ * Unpack runs in two passes over the untrusted message. The verify pass
+ * checks the tuple structure against the message and C structure bounds
+ * and validates every value. The copy pass then walks the verified message
+ * again and only copies data.
  */
 
-static inline int ipc_data_get(void *dest, uint32_t const *data,
-				      uint32_t const length,
-				      uint32_t const max_length)
-{
-	if (length > max_length) {
-		ipct_err("error: data too long %d for container %d\n",
-			length, max_length);
-		return -EINVAL;
-	}
-
-	/* copy data */
-	memcpy(dest, data, length);
+struct unpack_walk {
+	const struct ipct_action *action;
+	struct ipct_msg_context *ctx;
+	uint64_t *seen;			/**< mandatory elems received */
+};
 
-	/* zero pad any remaining space */
-	memset(dest + length, 0, max_length - length);
-	return 0;
-}
+_Static_assert(sizeof(((struct ipct_msg_reasm *)0)->seen) ==
+	       IPCT_MANDATORY_WORDS * sizeof(uint64_t),
+	       "reassembler mandatory bitmap size");
 
-static inline int ipc_data_uint64_get(uint64_t *dest, uint64_t const *data,
-				      uint64_t const min, uint64_t const max)
+/* verify tuple data for elem */
+static int elem_verify(const struct unpack_walk *walk, int elem,
+		       uint32_t base, const void *tuple_data,
+		       uint32_t type_data_size, const void *end)
 {
-	if (*data < min || *data > max) {
-		ipct_err("error: uint64_t %lu out of range %lu..%lu\n",
-			*data, min, max);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
+	const struct ipct_elem_table *elems = &walk->action->elems;
+	const struct ipct_elem_conv *conv = &elems->conv[elem];
+	uint32_t elem_data_size = conv->data_size;
 
-static inline int ipc_data_int64_get(int64_t *dest, int64_t const *data,
-				      int64_t const min, int64_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: int64_t %ld out of range %ld..%ld\n",
-			*data, min, max);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
+	log_elem_dump(__func__, elems->elem[elem]);
 
-static inline int ipc_data_uint32_get(uint32_t *dest, uint32_t const *data,
-				      uint32_t const min, uint32_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: uint32_t %u out of range %u..%u\n",
-			*data, min, max);
+	/* check that tuple data wont overflow target */
+	if (base + conv->c_offset + conv->c_size > walk->ctx->dest.size) {
+		ipct_err("error: tuple id %d overflows C struct\n",
+			 elems->id[elem]);
 		return -EINVAL;
 	}
-	*dest = *data;
-	return 0;
-}
 
-static inline int ipc_data_int32_get(int32_t *dest, int32_t const *data,
-				      int32_t const min, int32_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: int32_t %d out of range %d..%d\n",
-			*data, min, max);
+	/* validate that type data size matches reported (word padded) size */
+	if (type_data_size != elem_data_size &&
+	    type_data_size != IPCT_TUPLE_ALIGN(elem_data_size)) {
+		ipct_err("error: size mismatch. tuple size %d elem size %d\n",
+			 type_data_size, elem_data_size);
 		return -EINVAL;
 	}
-	*dest = *data;
-	return 0;
-}
 
-static inline int ipc_data_uint16_get(uint16_t *dest, uint16_t const *data,
-				      uint16_t const min, uint16_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: uint16_t %u out of range %u..%u\n",
-			*data, min, max);
+	/* does data exist in message */
+	if (tuple_data + elem_data_size > end) {
+		ipct_err("error: tuple id %d data outside of message\n",
+			 elems->id[elem]);
 		return -EINVAL;
 	}
-	*dest = *data;
-	return 0;
-}
 
-static inline int ipc_data_int16_get(int16_t *dest, int16_t const *data,
-				      int16_t const min, int16_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: int16_t %d out of range %d..%d\n",
-			*data, min, max);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
+	elem_printf(elems->elem[elem], (void *)tuple_data);
 
-static inline int ipc_data_uint8_get(uint8_t *dest, uint16_t const *data,
-				      uint8_t const min, uint8_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: uint8_t %u out of range %u..%u\n",
-			*data, min, max);
+	if (!codec_conv_valid(conv, &elems->limit[elem], elems->id[elem],
+			      tuple_data))
 		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
 
-static inline int ipc_data_int8_get(int8_t *dest, uint16_t const  *data,
-				      int8_t const min, int8_t const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: int8_t %d out of range %d..%d\n",
-			(int8_t)(*data), min, max);
-		return -EINVAL;
-	}
-	*dest = *data;
 	return 0;
 }
 
-static inline int ipc_data_double_get(double *dest, double const *data,
-				      double const min, double const max)
+/* get the elem for tuple data index i or -1 if it's not in scope */
+static int tuple_get_elem(const struct unpack_walk *walk,
+			  const struct ipct_pack_scope *scope,
+			  const struct ipct_tuple *tuple, uint32_t i)
 {
-	if (*data < min || *data > max) {
-		ipct_err("error: double %f out of range %f..%f\n",
-			*data, min, max);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
+	int elem;
 
-static inline int ipc_data_float_get(float *dest, float const *data,
-				      float const min, float const max)
-{
-	if (*data < min || *data > max) {
-		ipct_err("error: float %f out of range %f..%f\n",
-			*data, min, max);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
+	/* is tuple found ? - only elems of this C struct are used */
+	elem = action_get_elem(walk->action, tuple->id + i);
+	if (elem < 0 || walk->action->elems.desc[elem] != scope->desc_num)
+		return -1;
 
-static inline int ipc_data_uint64_mask_get(uint64_t *dest, uint64_t const *data,
-					   uint64_t const mask)
-{
-	/* valid bits are in mask only */
-	if (*data & ~mask) {
-		ipct_err("error: mask64 value 0x%16.16lx invalid for mask 0x%16.16lx\n",
-			*data, mask);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
+	return elem;
 }
 
-static inline int ipc_data_uint32_mask_get(uint32_t *dest, uint32_t const *data,
-					   uint32_t const mask)
+/* C array elems are placed by their index in the array */
+static inline uint32_t elem_base(const struct ipct_elem_table *elems,
+				 int elem, const struct ipct_tuple *tuple,
+				 uint32_t i, uint32_t base)
 {
-	/* valid bits are in mask only */
-	if (*data & ~mask) {
-		ipct_err("error: mask32 value 0x%8.8x invalid for mask 0x%8.8x\n",
-				*data, mask);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
+	return base + (tuple->id + i - elems->id[elem]) *
+		elems->conv[elem].c_size;
 }
 
-static inline int ipc_data_uint16_mask_get(uint16_t *dest, uint16_t const *data,
-					   uint16_t const mask)
+/* get the subaction scope for tuple array or NULL if unknown */
+static const struct ipct_pack_scope *
+tuple_array_scope(const struct ipct_pack_scope *scope,
+		  const struct ipct_tuple *tuple)
 {
-	/* valid bits are in mask only */
-	if (*data & ~mask) {
-		ipct_err("error: mask16 value 0x%4.4x invalid for mask 0x%4.4x\n",
-			*data, mask);
-		return -EINVAL;
-	}
-	*dest = *data;
-	return 0;
-}
+	int i;
 
-static inline int ipc_data_uint8_mask_get(uint8_t *dest, uint8_t const *data,
-					   uint8_t const mask)
-{
-	/* valid bits are in mask only */
-	if (*data & ~mask) {
-		ipct_err("error: mask8 value 0x%2.2x invalid for mask 0x%2.2x\n",
-			*data, mask);
-		return -EINVAL;
+	/* array ID is the lowest tuple ID of the subaction */
+	for (i = 0; i < scope->num_children; i++) {
+		if (scope->child[i].key == tuple->id)
+			return &scope->child[i];
 	}
-	*dest = *data;
-	return 0;
+
+	return NULL;
 }
 
-static int elem_insert_data(const struct ipct_tuple_elem *elem,
-			struct ipct_msg_context *ctx, void *tuple_data,
-			uint32_t type_data_size)
+static int tuple_verify_each(struct unpack_walk *walk,
+			     const struct ipct_pack_scope *scope,
+			     uint32_t base, const struct ipct_tuple *tuple,
+			     const void *end, uint32_t tuples_remain,
+			     int depth);
+
+/* verify a tuple array and each entry against the subaction C array */
+static int tuple_array_verify(struct unpack_walk *walk,
+			      const struct ipct_pack_scope *scope,
+			      uint32_t base, const struct ipct_tuple *tuple,
+			      int depth)
 {
-	uint32_t elem_data_size;
+	const struct ipct_elem_var_array *var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+	const struct ipct_pack_scope *child;
+	const void *entry;
+	int i, ret;
 
-	/* check that tuple data wont overflow target */
-	if (type_data_size + elem->offset > ctx->src.size) {
-		ipct_err("error: tuple overflows ctx->src.base\n");
-		return -EINVAL;
+	child = tuple_array_scope(scope, tuple);
+	if (!child) {
+		ipct_log("unpack: unknown tuple array id %d\n", tuple->id);
+		return 0; /* ignore it */
 	}
 
-	/* is tuple data size valid ? */
-	elem_data_size = elem_get_data_size(elem);
-	if (!elem_data_size) {
-		ipct_err("error: invalid elem data size\n");
+	/* check: entries fit the C array and are word aligned */
+	if (var->count > child->count ||
+	    var->elem_bytes != IPCT_TUPLE_ALIGN(var->elem_bytes)) {
+		ipct_err("error: invalid tuple array id %d count %d size %d\n",
+			 tuple->id, var->count, var->elem_bytes);
 		return -EINVAL;
 	}
 
-	/* validate that type data size matches reported size */
-	if (type_data_size != elem_data_size) {
-		ipct_err("error: size mismatch. tuple size %d elem size %d\n",
-				type_data_size, elem_data_size);
-		return -EINVAL;
-	}
-
-	/* does data exists in input buffer */
-	if (!is_ptr_valid(&ctx->src, tuple_data)) {
-		ipct_err("error: data outside of buffer\n");
-		return -EINVAL;
-	}
-	if (!is_ptr_valid(&ctx->src, tuple_data + elem_data_size)) {
-		ipct_err("error: data outside of buffer\n");
-			ipct_log("!! %p %p\n",
-			tuple_data + elem_data_size, ctx->src.base + ctx->src.size);
-		return -EINVAL;
+	for (i = 0; i < var->count; i++) {
+		entry = tuple_get_data(tuple, i);
+		ret = tuple_verify_each(walk, child,
+					base + child->offset + i * child->stride,
+					entry, entry + var->elem_bytes,
+					UINT32_MAX, depth + 1);
+		if (ret < 0)
+			return ret;
 	}
 
-	elem_printf(elem, tuple_data);
-
-	switch (elem->type) {
-	case ipct_type_int8_value:
-		return ipc_data_int8_get(ctx->dest.base + elem->offset,
-				(uint16_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_uint8_value:
-		return ipc_data_uint8_get(ctx->dest.base + elem->offset,
-				(uint16_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_int16_value:
-		return ipc_data_int16_get(ctx->dest.base + elem->offset,
-				(int16_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_uint16_value:
-	case ipct_type_boolean:
-		return ipc_data_uint16_get(ctx->dest.base + elem->offset,
-				(uint16_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_int32_value:
-		return ipc_data_int32_get(ctx->dest.base + elem->offset,
-				(int32_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_uint32_value:
-	case ipct_type_enum:
-		return ipc_data_uint32_get(ctx->dest.base + elem->offset,
-				(uint32_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_int64_value:
-		return ipc_data_int64_get(ctx->dest.base + elem->offset,
-				(int64_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_uint64_value:
-		return ipc_data_uint64_get(ctx->dest.base + elem->offset,
-				(uint64_t const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_float_value:
-		return ipc_data_float_get(ctx->dest.base + elem->offset,
-				(float const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_double_value:
-		return ipc_data_double_get(ctx->dest.base + elem->offset,
-				(double const *)tuple_data,
-				elem->value1, elem->value2);
-		break;
-	case ipct_type_uint8_mask:
-		return ipc_data_uint8_mask_get(ctx->dest.base + elem->offset,
-				(uint8_t const *)tuple_data,
-				elem->value1);
-		break;
-	case ipct_type_uint16_mask:
-		return ipc_data_uint16_mask_get(ctx->dest.base + elem->offset,
-				(uint16_t const *)tuple_data,
-				elem->value1);
-		break;
-	case ipct_type_uint32_mask:
-		return ipc_data_uint32_mask_get(ctx->dest.base + elem->offset,
-				(uint32_t const *)tuple_data,
-				elem->value1);
-		break;
-	case ipct_type_uint64_mask:
-		return ipc_data_uint64_mask_get(ctx->dest.base + elem->offset,
-				(uint64_t const *)tuple_data,
-				elem->value1);
-		break;
-	case ipct_type_string:
-	case ipct_type_uuid:
-	case ipct_type_data:
-		return ipc_data_get(ctx->dest.base + elem->offset,
-				   (uint32_t const *)tuple_data,
-					elem->value1, elem_data_size);
-		break;
-	default:
-		/* already checked above - should never get here */
-		return -EINVAL;
-	}
+	return 0;
 }
 
-
-/* unpack a tuple into a C ctx->src.base member */
-static int tuple_unpack(const struct ipct_tuple *tuple,
-			const struct ipct_action_def *action,
-			struct ipct_msg_context *ctx)
+/* verify each tuple data elem */
+static int tuple_verify(struct unpack_walk *walk,
+			const struct ipct_pack_scope *scope, uint32_t base,
+			const struct ipct_tuple *tuple, const void *end)
 {
-	const struct ipct_tuple_elem *elem;
-	uint32_t type_data_size;
-	void *tuple_data;
-	int i, ret;
-	uint32_t elem_count;
+	const struct ipct_elem_table *elems = &walk->action->elems;
+	uint32_t type_data_size, elem_count, i;
+	int elem, ret;
 
-	ipct_log("  unpack: tuple type %d id %d\n",
-		tuple->type, tuple->id);
+	ipct_log("  unpack: tuple type %d id %d\n", tuple->type, tuple->id);
 
 	/* check is tuple array */
 	elem_count = tuple_data_count(tuple);
 	if (elem_count == 0) {
-		ipct_log("unpack: tuple id %d has no data\n", tuple->id);
+		ipct_err("error: tuple id %d has no data\n", tuple->id);
 		return -EINVAL;
 	}
 
 	/* is tuple data size valid ? */
 	type_data_size = tuple_data_size(tuple);
 	if (!type_data_size) {
-		ipct_err("error: invalid tuple size for id %d\n",
-			tuple->id);
+		ipct_err("error: invalid tuple size for id %d\n", tuple->id);
 		return -EINVAL;
 	}
 
 	/* for each tuple data element */
 	for (i = 0; i < elem_count; i++) {
-
-		/* is tuple found ? */
-		elem = get_tuple_elem(action->desc, tuple, i, 0);
-		if (!elem) {
-			ipct_log("unpack: unknown tuple id %d\n", tuple->id);
-			return 0; /* no - ignore it */
+		elem = tuple_get_elem(walk, scope, tuple, i);
+		if (elem < 0) {
+			ipct_log("unpack: unknown tuple id %d\n", tuple->id + i);
+			continue; /* ignore it */
 		}
-
-		log_elem_dump(__func__, elem);
-
-		/* tuple data exists ? */
-		tuple_data = tuple_get_data(tuple, i);
-		if (!tuple_data) {
-			ipct_err("error: cant get tuple data for id %d\n",
-				tuple->id);
-			return -EINVAL;
-		}
-
-		ret = elem_insert_data(elem, ctx, tuple_data, type_data_size);
+		ret = elem_verify(walk, elem, elem_base(elems, elem, tuple, i, base),
+				  tuple_get_data(tuple, i), type_data_size,
+				  end);
 		if (ret < 0) {
-			ipct_err("error: can't insert tuple id %d from 0x%lx\n",
-					tuple->id + i, ctx->src.offset);
+			ipct_err("error: can't unpack tuple id %d\n",
+				 tuple->id + i);
 			return ret;
 		}
+
+		/* C arrays are only received when the whole array is here */
+		if (tuple->id + i == elems->id[elem] &&
+		    elem_count - i >= elems->count[elem])
+			mandatory_set(walk->seen, elems, elem);
 	}
 
 	return 0;
 }
 
-static int tuple_for_each(const struct ipct_tuple *tuple,
-			  const struct ipct_action_def *action_def,
-			  struct ipct_msg_context *ctx, void *end_of_message,
-			  uint32_t tuples_remain, int depth)
+/* verify pass - check tuple structure, bounds and values */
+static int tuple_verify_each(struct unpack_walk *walk,
+			     const struct ipct_pack_scope *scope,
+			     uint32_t base, const struct ipct_tuple *tuple,
+			     const void *end, uint32_t tuples_remain,
+			     int depth)
 {
 	const struct ipct_tuple *next;
-	int remaining_bytes = end_of_message - (void *)tuple;
 	int ret;
 
 	/* check: make sure we don't recurse too deep */
 	if (depth > IPCT_MAX_DEPTH) {
-		ipct_err("error: ctx->src.base too deep %d\n", depth);
+		ipct_err("error: message too deep %d\n", depth);
 		return -EINVAL;
 	}
 
 	ipct_log("unpack: action 0x%x at depth %d\n",
-		action_def->action_id, depth);
+		 walk->action->def->action_id, depth);
 
 	/* process each tuple */
-	while (tuples_remain && remaining_bytes) {
+	while (tuples_remain && (void *)tuple < end) {
 
 		ipct_log(" unpack: new tuple %d type %d\n",
-			tuple->id, tuple->type);
-
-		/* check: does this tuple start in message */
-		if ((void *)tuple >= end_of_message){
-			ipct_err("error: tuple start not in message\n");
-			return -EINVAL;
-		}
+			 tuple->id, tuple->type);
 
 		/* check: does this tuple end in message */
-		if ((void *)tuple +  tuple_size(tuple) > end_of_message) {
+		if ((void *)tuple + tuple_size(tuple) > end) {
 			ipct_err("error: tuple end not in message\n");
 			return -EINVAL;
 		}
 
-		if (tuple->type == IPCT_TUPLE_TYPE_TUPLE_ARRAY) {
-
-			/* unpack this tuple */
-			ret = tuple_for_each(tuple_get_data(tuple, 0),
-					action_def, ctx, end_of_message,
-					tuple_data_count(tuple), depth + 1);
-			if (ret < 0) {
-				ipct_err("error: failed to iterate tuple\n");
-				return ret;
-			}
-		} else {
-			/* unpack this tuple */
-			ret = tuple_unpack(tuple, action_def, ctx);
-			if (ret < 0) {
-				ipct_err("error: failed to unpack tuple\n");
-				return ret;
-			}
+		/* check: array reserved word is 0 */
+		if (!tuple_reserved_valid(tuple)) {
+			ipct_err("error: tuple id %d reserved not 0\n",
+				 tuple->id);
+			return -EINVAL;
 		}
 
+		if (tuple->type == IPCT_TUPLE_TYPE_TUPLE_ARRAY)
+			ret = tuple_array_verify(walk, scope, base, tuple,
+						 depth);
+		else
+			ret = tuple_verify(walk, scope, base, tuple, end);
+		if (ret < 0)
+			return ret;
+
 		/* get next tuple */
 		next = ipc_next_tuple(tuple);
 		if (next <= tuple) {
@@ -457,7 +261,6 @@ static int tuple_for_each(const struct ipct_tuple *tuple,
 			return -EINVAL;
 		}
 
-		remaining_bytes -= tuple_size(tuple);
 		tuples_remain--;
 		tuple = next;
 	}
@@ -465,6 +268,218 @@ static int tuple_for_each(const struct ipct_tuple *tuple,
 	return 0;
 }
 
+/* copy pass - message has been verified so there are no error paths */
+static void tuple_copy_each(const struct unpack_walk *walk,
+			    const struct ipct_pack_scope *scope,
+			    uint32_t base, const struct ipct_tuple *tuple,
+			    const void *end, uint32_t tuples_remain)
+{
+	const struct ipct_pack_scope *child;
+	const struct ipct_elem_var_array *var;
+	const struct ipct_elem_table *elems = &walk->action->elems;
+	const struct ipct_elem_conv *conv;
+	void *dest = walk->ctx->dest.base;
+	uint32_t elem_count, i;
+	int elem;
+	const void *entry;
+
+	for (; tuples_remain && (void *)tuple < end;
+	     tuples_remain--, tuple = ipc_next_tuple(tuple)) {
+
+		if (tuple->type == IPCT_TUPLE_TYPE_TUPLE_ARRAY) {
+			child = tuple_array_scope(scope, tuple);
+			if (!child)
+				continue;
+
+			var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+			for (i = 0; i < var->count; i++) {
+				entry = tuple_get_data(tuple, i);
+				tuple_copy_each(walk, child,
+						base + child->offset +
+						i * child->stride,
+						entry, entry + var->elem_bytes,
+						UINT32_MAX);
+			}
+			continue;
+		}
+
+		elem_count = tuple_data_count(tuple);
+		for (i = 0; i < elem_count; i++) {
+			elem = tuple_get_elem(walk, scope, tuple, i);
+			if (elem < 0)
+				continue;
+
+			conv = &elems->conv[elem];
+			codec_conv_copy(conv, dest + elem_base(elems, elem, tuple,
+							       i, base) +
+					conv->c_offset, tuple_get_data(tuple, i));
+		}
+	}
+}
+
+/* verify every tuple before anything is copied */
+static int unpack_tuples(struct unpack_walk *walk,
+			 const struct ipct_action *action,
+			 struct ipct_msg_context *ctx, uint64_t *seen,
+			 const struct ipct_tuple *tuple, const void *end,
+			 uint32_t num_tuples)
+{
+	int ret;
+
+	walk->action = action;
+	walk->ctx = ctx;
+	walk->seen = seen;
+	ret = tuple_verify_each(walk, &action->scope, 0, tuple, end,
+				num_tuples, 0);
+	if (ret < 0)
+		return ret;
+
+	tuple_copy_each(walk, &action->scope, 0, tuple, end, num_tuples);
+	return 0;
+}
+
+/* get the IPCT_FLAGS_* for the header */
+uint32_t unpack_hdr_flags(struct ipct_hdr *hdr)
+{
+	uint32_t flags = IPCT_FLAGS_NONE;
+
+	if (hdr->status)
+		flags |= IPCT_FLAGS_REPLY_NACK;
+	if (hdr->priority)
+		flags |= IPCT_FLAGS_PRIORTY;
+	if (hdr->datagram)
+		flags |= IPCT_FLAGS_DATAGRAM;
+	if (hdr->route) {
+		flags |= IPCT_FLAGS_ROUTE;
+		if (ipct_get_receiver(hdr) == SOF_IPCT_ROUTE_BROADCAST)
+			flags |= IPCT_FLAGS_BROADCAST;
+	}
+
+	return flags;
+}
+
+/* check the route and elems headers are in src before any of them is read */
+static int unpack_hdr_fits(struct ipct_hdr *hdr, size_t src_size)
+{
+	if (src_size < sizeof(*hdr)) {
+		ipct_err("ipct: error message too small\n");
+		return -EINVAL;
+	}
+
+	if (IPCT_HDR_GET_HDR_SIZE(hdr) > src_size) {
+		ipct_err("ipct: error action 0x%x headers exceed buffer\n",
+			 IPCT_HDR_GET_ID(hdr));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Validate the message headers fit in src_size bytes and get the body size
+ * and number of tuples.
+ */
+int unpack_hdr_check(struct ipct_hdr *hdr, size_t src_size, uint32_t *size,
+		     uint32_t *num_tuples)
+{
+	uint32_t id = IPCT_HDR_GET_ID(hdr);
+
+	/* validate headers fit in buffer */
+	if (IPCT_HDR_GET_HDR_SIZE(hdr) > src_size) {
+		ipct_err("ipct: error action 0x%x headers exceed buffer\n", id);
+		return -EINVAL;
+	}
+
+	/* private data blocks have no tuples */
+	if (hdr->block) {
+		ipct_err("ipct: error action 0x%x is a data block\n", id);
+		return -EINVAL;
+	}
+
+	/* stream config expects tuples */
+	if (!IPCT_HDR_GET_ELEM_PTR(hdr)) {
+		ipct_err("ipct: error can't find tuple for action 0x%x\n", id);
+		return -EINVAL;
+	}
+
+	/* we have tuples, but how many ? */
+	*num_tuples = ipct_get_tuples(hdr);
+	if (*num_tuples == 0) {
+		ipct_err("ipct: error action 0x%x has no tuples\n", id);
+		return -EINVAL;
+	}
+
+	/* validate size - size is mandatory */
+	*size = ipct_get_size(hdr);
+	if (*size == 0) {
+		ipct_err("ipct: error can't find size for action 0x%x\n", id);
+		return -EINVAL;
+	}
+
+	/* validate message fits in buffer */
+	if (IPCT_HDR_GET_HDR_SIZE(hdr) + *size > src_size) {
+		ipct_err("ipct: error action 0x%x size %d exceeds buffer\n",
+			 id, *size);
+		return -EINVAL;
+	}
+
+	/* validate against minimum size */
+	if (*size < tuple_size(IPCT_HDR_GET_TUPLE(hdr))) {
+		ipct_err("ipct: error action 0x%x too small\n", id);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Private data block - the body is the C structure padded to a word. The
+ * block size must match the action C structure exactly.
+ */
+static int unpack_block(struct ipct_msg_context *ctx,
+			const struct ipct_action *action)
+{
+	struct ipct_hdr *hdr = ctx->src.base;
+	uint32_t size;
+
+	if (!hdr->block || !action_is_block(action)) {
+		ipct_err("ipct: error action 0x%x data block mismatch\n",
+			 ctx->id);
+		return -EINVAL;
+	}
+
+	if (IPCT_HDR_GET_HDR_SIZE(hdr) > ctx->src.size ||
+	    !IPCT_HDR_GET_ELEM_PTR(hdr)) {
+		ipct_err("ipct: error action 0x%x bad block headers\n", ctx->id);
+		return -EINVAL;
+	}
+
+	size = ipct_get_size(hdr);
+	if (size != action->plan_bytes) {
+		ipct_err("ipct: error action 0x%x block size %d expected %d\n",
+			 ctx->id, size, action->plan_bytes);
+		return -EINVAL;
+	}
+
+	if (IPCT_HDR_GET_HDR_SIZE(hdr) + size > ctx->src.size) {
+		ipct_err("ipct: error action 0x%x size %d exceeds buffer\n",
+			 ctx->id, size);
+		return -EINVAL;
+	}
+
+	if (ctx->dest.size < action->def->desc->size) {
+		ipct_err("ipct: error action 0x%x block needs %d bytes dest is %zu\n",
+			 ctx->id, action->def->desc->size, ctx->dest.size);
+		return -EINVAL;
+	}
+
+	memcpy(ctx->dest.base, IPCT_HDR_GET_TUPLE(hdr),
+	       action->def->desc->size);
+
+	ctx->src.offset = IPCT_HDR_GET_HDR_SIZE(hdr) + size;
+	return 0;
+}
+
 /**
  * Convert message from tuples to internal C ctx->src.base.
  *
@@ -473,58 +488,161 @@ static int tuple_for_each(const struct ipct_tuple *tuple,
  */
 int ipct_unpack(struct ipct_msg_context *ctx)
 {
-	const struct ipct_action_def *action_def;
+	const struct ipct_action *action;
 	const struct ipct_tuple *tuple;
 	struct ipct_hdr *hdr = ctx->src.base;
+	struct unpack_walk walk;
+	uint64_t seen[IPCT_MANDATORY_WORDS];
 	uint32_t num_tuples;
 	void *end_of_message;
 	uint32_t size;
 
 	int ret = 0;
 
+	ret = unpack_hdr_fits(hdr, ctx->src.size);
+	if (ret < 0)
+		return ret;
+
+	/* message ID, flags and address come from the header */
+	ctx->id = IPCT_HDR_GET_ID(hdr);
+	ctx->flags = unpack_hdr_flags(hdr);
+	ctx->addr = ipct_get_receiver(hdr);
+
 	/* validate ID - is it supported ?*/
-	action_def = get_action_def(ctx->id);
-	if (!action_def) {
+	action = get_action(ctx->ipct, ctx->id);
+	if (!action) {
 		ipct_err("ipct: error can't find action 0x%x\n", ctx->id);
 		return -EINVAL;
 	}
 
-	/* stream config expects tuples */
-	tuple = IPCT_HDR_GET_ELEM_PTR(hdr);
-	if (!tuple) {
-		ipct_err("ipct: error can't find tuple for action 0x%x\n", ctx->id);
-		return -EINVAL;
+	/* fast path - private data block is copied as is */
+	if (hdr->block || action_is_block(action))
+		return unpack_block(ctx, action);
+
+	ret = unpack_hdr_check(hdr, ctx->src.size, &size, &num_tuples);
+	if (ret < 0)
+		return ret;
+
+	/* calculate end of message */
+	tuple = IPCT_HDR_GET_TUPLE(hdr);
+	end_of_message = (void *)hdr + IPCT_HDR_GET_HDR_SIZE(hdr) + size;
+
+	/* fast path - message has the layout we pack with */
+	if (ctx->dest.size >= action->def->desc->size) {
+		ret = codec_unpack(action, ctx->dest.base, tuple, size,
+				   num_tuples);
+		if (ret < 0) {
+			ipct_err("ipct: failed to unpack\n");
+			return ret;
+		}
+		if (ret)
+			goto out;
 	}
 
-	/* we have tuples, but how many ? */
-	num_tuples = ipct_get_tuples(hdr);
-	if (num_tuples == 0) {
-		ipct_err("ipct: error action 0x%x has no tuples\n", ctx->id);
+	memset(seen, 0, sizeof(seen));
+	ret = unpack_tuples(&walk, action, ctx, seen, tuple, end_of_message,
+			    num_tuples);
+	if (ret == 0)
+		ret = action_mandatory_check(action, seen);
+	if (ret < 0) {
+		ipct_err("ipct: failed to unpack\n");
+		return ret;
+	}
+
+out:
+	/* finished - whole message is consumed */
+	ctx->src.offset = end_of_message - ctx->src.base;
+	return 0;
+}
+
+/**
+ * Unpack a chunk of a compound message into ctx->dest. Chunks must arrive
+ * in order from the one holding the first tuple of the plan, the tuple count
+ * and mandatory tuples are checked once the last chunk is here.
+ *
+ * Returns the number of chunks still to come or a negative error code.
+ */
+int ipct_unpack_chunk(struct ipct_msg_context *ctx,
+		      struct ipct_msg_reasm *reasm)
+{
+	const struct ipct_action *action;
+	const struct ipct_tuple *tuple;
+	struct ipct_hdr *hdr = ctx->src.base;
+	struct unpack_walk walk;
+	uint32_t num_tuples, size, remaining;
+	void *end_of_message;
+	int ret;
+
+	ret = unpack_hdr_fits(hdr, ctx->src.size);
+	if (ret < 0)
+		return ret;
+
+	ctx->id = IPCT_HDR_GET_ID(hdr);
+	ctx->flags = unpack_hdr_flags(hdr);
+	ctx->addr = ipct_get_receiver(hdr);
+
+	action = get_action(ctx->ipct, ctx->id);
+	if (!action) {
+		ipct_err("ipct: error can't find action 0x%x\n", ctx->id);
 		return -EINVAL;
 	}
 
-	/* validate size - size is mandatory */
-	size = ipct_get_size(hdr);
-	if (size == 0) {
-		ipct_err("ipct: error can't find size for action 0x%x\n", ctx->id);
+	if (action_is_block(action)) {
+		ipct_err("ipct: error block action 0x%x can't be chunked\n",
+			 ctx->id);
 		return -EINVAL;
 	}
 
-	/* validate against minimum size */
-	if (size < tuple_size(tuple)) {
-		ipct_err("ipct: error action 0x%x too small\n", ctx->id);
+	ret = unpack_hdr_check(hdr, ctx->src.size, &size, &num_tuples);
+	if (ret < 0)
+		return ret;
+
+	/* chunks must continue the message in progress */
+	remaining = ipct_get_remaining(hdr);
+	if (reasm->remaining &&
+	    (ctx->id != reasm->id || remaining + 1 != reasm->remaining)) {
+		ipct_err("ipct: error chunk 0x%x:%d out of sequence, expected 0x%x:%d\n",
+			 ctx->id, remaining, reasm->id, reasm->remaining - 1);
 		return -EINVAL;
 	}
 
-	/* calculate end of message */
-	end_of_message = (void *)hdr + IPCT_HDR_GET_HDR_SIZE(hdr) + size;
 	tuple = IPCT_HDR_GET_TUPLE(hdr);
+	end_of_message = (void *)hdr + IPCT_HDR_GET_HDR_SIZE(hdr) + size;
 
-	/* unpack tuples */
-	ret = tuple_for_each(tuple, action_def, ctx, end_of_message, num_tuples, 0);
-	if (ret < 0)
-		ipct_err("ipct: failed to unpack\n");
+	/* first chunk - must start with the first tuple of the plan */
+	if (!reasm->remaining) {
+		if (!num_tuples || size < sizeof(*tuple) ||
+		    memcmp(tuple, action->template, sizeof(*tuple))) {
+			ipct_err("ipct: error chunk 0x%x:%d is not a first chunk\n",
+				 ctx->id, remaining);
+			return -EINVAL;
+		}
+		reasm->id = ctx->id;
+		reasm->dest_addr = ctx->addr;
+		reasm->flags = ctx->flags;
+		reasm->tuples = 0;
+		memset(reasm->seen, 0, sizeof(reasm->seen));
+	}
+
+	ret = unpack_tuples(&walk, action, ctx, reasm->seen, tuple,
+			    end_of_message, num_tuples);
+	reasm->tuples += num_tuples;
+
+	/* last chunk - every tuple of the plan must have arrived */
+	if (ret == 0 && remaining == 0 &&
+	    reasm->tuples != action->num_tuples) {
+		ipct_err("ipct: error action 0x%x got %d of %d tuples\n",
+			 ctx->id, reasm->tuples, action->num_tuples);
+		ret = -EINVAL;
+	}
+	if (ret == 0 && remaining == 0)
+		ret = action_mandatory_check(action, reasm->seen);
+	if (ret < 0) {
+		ipct_err("ipct: failed to unpack chunk\n");
+		return ret;
+	}
 
-	/* finished */
-	return ret;
+	reasm->remaining = remaining;
+	ctx->src.offset = end_of_message - ctx->src.base;
+	return remaining;
 }
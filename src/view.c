@@ -0,0 +1,421 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+#include "priv.h"
+
+/*
+ * Message views - tuples are validated once when the view is created and
+ * then read in place. Messages in our packed layout use the static data
+ * offsets of the action, any other layout is indexed into the view.
+ */
+
+/* add the tuple data offsets to the view */
+static int view_tuple_index(struct ipct_msg_view *view,
+			    const struct ipct_action *action,
+			    const struct ipct_tuple *tuple, const void *end,
+			    uint64_t *seen)
+{
+	const struct ipct_elem_table *elems = &action->elems;
+	const struct ipct_elem_conv *conv;
+	uint32_t type_data_size, elem_data_size, count, i;
+	const void *data;
+	int elem;
+
+	count = tuple_data_count(tuple);
+	type_data_size = tuple_data_size(tuple);
+	if (!count || !type_data_size) {
+		ipct_err("error: invalid tuple id %d\n", tuple->id);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < count; i++) {
+
+		/* only top level elems can be viewed - ignore others */
+		elem = action_get_elem(action, tuple->id + i);
+		if (elem < 0 || elems->desc[elem] != IPCT_DESC_ACTION)
+			continue;
+		conv = &elems->conv[elem];
+
+		/* validate that type data size matches (word padded) size */
+		elem_data_size = conv->data_size;
+		if (type_data_size != elem_data_size &&
+		    type_data_size != IPCT_TUPLE_ALIGN(elem_data_size)) {
+			ipct_err("error: size mismatch. tuple size %d elem size %d\n",
+				 type_data_size, elem_data_size);
+			return -EINVAL;
+		}
+
+		data = tuple_get_data(tuple, i);
+		if (data + elem_data_size > end) {
+			ipct_err("error: data outside of buffer\n");
+			return -EINVAL;
+		}
+
+		if (!codec_conv_valid(conv, &elems->limit[elem], tuple->id + i,
+				      data))
+			return -EINVAL;
+
+		view->slot[action_index_slot(action, tuple->id + i)] =
+			data - view->body;
+
+		/* C arrays are only received when the whole array is here */
+		if (tuple->id + i == elems->id[elem] &&
+		    count - i >= elems->count[elem])
+			mandatory_set(seen, elems, elem);
+	}
+
+	return 0;
+}
+
+/* index the top level tuples of a message not in our packed layout */
+static int view_index(struct ipct_msg_view *view,
+		      const struct ipct_action *action, uint32_t size,
+		      uint32_t num_tuples)
+{
+	const struct ipct_tuple *tuple = view->body;
+	const struct ipct_tuple *next;
+	const void *end = view->body + size;
+	uint64_t seen[IPCT_MANDATORY_WORDS] = {0};
+	int ret;
+
+	if (action->index_size > IPCT_VIEW_MAX_SLOTS) {
+		ipct_err("error: action 0x%x has too many tuples to view\n",
+			 action->def->action_id);
+		return -E2BIG;
+	}
+
+	memset(view->slot, 0xff, action->index_size * sizeof(view->slot[0]));
+	view->offsets = view->slot;
+
+	while (num_tuples--) {
+
+		/* check: does this tuple start and end in message */
+		if ((void *)tuple >= end ||
+		    (void *)tuple + tuple_size(tuple) > end) {
+			ipct_err("error: tuple not in message\n");
+			return -EINVAL;
+		}
+
+		/* check: array reserved word is 0 */
+		if (!tuple_reserved_valid(tuple)) {
+			ipct_err("error: tuple id %d reserved not 0\n",
+				 tuple->id);
+			return -EINVAL;
+		}
+
+		/* subaction arrays are not viewed */
+		if (tuple->type != IPCT_TUPLE_TYPE_TUPLE_ARRAY) {
+			ret = view_tuple_index(view, action, tuple, end, seen);
+			if (ret < 0)
+				return ret;
+		}
+
+		next = ipc_next_tuple(tuple);
+		if (next <= tuple) {
+			ipct_err("error: illegal next tuple\n");
+			return -EINVAL;
+		}
+		tuple = next;
+	}
+
+	return action_mandatory_check(action, seen);
+}
+
+static int view_init(struct ipct_context *ipct, struct ipct_msg_view *view,
+		     void *src, size_t src_size)
+{
+	const struct ipct_action *action;
+	struct ipct_hdr *hdr = src;
+	uint32_t size, num_tuples;
+	int ret;
+
+	if (src_size < sizeof(*hdr))
+		return -EINVAL;
+
+	view->id = IPCT_HDR_GET_ID(hdr);
+	action = get_action(ipct, view->id);
+	if (!action)
+		return -EINVAL;
+
+	/* private data blocks have no tuples to view */
+	if (action_is_block(action))
+		return -EINVAL;
+
+	ret = unpack_hdr_check(hdr, src_size, &size, &num_tuples);
+	if (ret < 0)
+		return ret;
+
+	view->action = action;
+	view->body = IPCT_HDR_GET_TUPLE(hdr);
+
+	/* fast path - message has the layout we pack with */
+	ret = codec_check(action, view->body, size, num_tuples);
+	if (ret < 0)
+		return ret;
+	if (ret) {
+		view->offsets = action->view_offsets;
+		return 0;
+	}
+
+	return view_index(view, action, size, num_tuples);
+}
+
+/** \brief
+ *  Create a view of received IPCT message in src using the klasses of
+ *  context ipct. The message is validated and must not change while the
+ *  view is used.
+ */
+int ipct_ctx_msg_view_init(struct ipct_context *ipct,
+			   struct ipct_msg_view *view, void *src,
+			   size_t src_size)
+{
+	uint32_t epoch;
+	int ret;
+
+	epoch = registry_read_lock(&ipct->registry);
+	ret = view_init(ipct, view, src, src_size);
+	registry_read_unlock(&ipct->registry, epoch);
+
+	return ret;
+}
+
+/* kinds of value read by the view getters */
+enum view_kind {
+	VIEW_UINT,
+	VIEW_INT,
+	VIEW_FLOAT,
+	VIEW_DATA,
+};
+
+/* masks, enums and booleans are read as unsigned values */
+static enum view_kind view_elem_kind(const struct ipct_tuple_elem *elem)
+{
+	switch (elem->type) {
+	case ipct_type_int8_value:
+	case ipct_type_int16_value:
+	case ipct_type_int32_value:
+	case ipct_type_int64_value:
+		return VIEW_INT;
+	case ipct_type_float_value:
+	case ipct_type_double_value:
+		return VIEW_FLOAT;
+	case ipct_type_string:
+	case ipct_type_uuid:
+	case ipct_type_data:
+		return VIEW_DATA;
+	default:
+		return VIEW_UINT;
+	}
+}
+
+/* get tuple data for a C member of kind and c_size bytes */
+static int view_get(const struct ipct_msg_view *view, uint32_t tuple_id,
+		    enum view_kind kind, uint32_t c_size, const void **data)
+{
+	const struct ipct_action *action = view->action;
+	uint32_t offset;
+	int elem;
+
+	elem = action_get_elem(action, tuple_id);
+	if (elem < 0 || action->elems.desc[elem] != IPCT_DESC_ACTION)
+		return -ENOENT;
+
+	/* check: same type - size alone can't tell float from uint32 */
+	if (view_elem_kind(action->elems.elem[elem]) != kind ||
+	    (c_size && action->elems.conv[elem].c_size != c_size)) {
+		ipct_err("error: tuple id %d is not a %d byte type %d\n",
+			 tuple_id, c_size, kind);
+		return -EINVAL;
+	}
+
+	/* is tuple in message */
+	offset = view->offsets[action_index_slot(action, tuple_id)];
+	if (offset == UINT32_MAX)
+		return -ENOENT;
+
+	*data = view->body + offset;
+	return 0;
+}
+
+/* 8 bit values use 16 bit tuple data */
+int ipct_view_get_u8(const struct ipct_msg_view *view, uint32_t tuple_id,
+		     uint8_t *out)
+{
+	const void *data;
+	uint16_t u16;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_UINT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(&u16, data, sizeof(u16));
+	*out = u16;
+	return 0;
+}
+
+int ipct_view_get_s8(const struct ipct_msg_view *view, uint32_t tuple_id,
+		     int8_t *out)
+{
+	const void *data;
+	int16_t s16;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_INT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(&s16, data, sizeof(s16));
+	*out = s16;
+	return 0;
+}
+
+int ipct_view_get_u16(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      uint16_t *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_UINT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_s16(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      int16_t *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_INT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_u32(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      uint32_t *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_UINT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_s32(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      int32_t *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_INT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_u64(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      uint64_t *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_UINT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_s64(const struct ipct_msg_view *view, uint32_t tuple_id,
+		      int64_t *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_INT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_float(const struct ipct_msg_view *view, uint32_t tuple_id,
+			float *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_FLOAT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+int ipct_view_get_double(const struct ipct_msg_view *view, uint32_t tuple_id,
+			 double *out)
+{
+	const void *data;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_FLOAT, sizeof(*out), &data);
+	if (ret < 0)
+		return ret;
+
+	memcpy(out, data, sizeof(*out));
+	return 0;
+}
+
+/* get pointer to string, UUID or data tuple data and its valid size */
+int ipct_view_get_data(const struct ipct_msg_view *view, uint32_t tuple_id,
+		       const void **data, size_t *size)
+{
+	const struct ipct_action *action = view->action;
+	const struct ipct_tuple_elem *elem;
+	int ret;
+
+	ret = view_get(view, tuple_id, VIEW_DATA, 0, data);
+	if (ret < 0)
+		return ret;
+
+	elem = action->elems.elem[action_get_elem(action, tuple_id)];
+	switch (elem->type) {
+	case ipct_type_string:
+	case ipct_type_data:
+		*size = elem->value1;
+		return 0;
+	case ipct_type_uuid:
+		*size = elem_get_data_size(elem);
+		return 0;
+	default:
+		ipct_err("error: tuple id %d is not data\n", tuple_id);
+		return -EINVAL;
+	}
+}
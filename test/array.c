@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * C arrays - each C array member is packed as one tuple array with a single
+ * copy. Mandatory arrays are only received when the whole array is there
+ * and arrays of strings or data are rejected.
+ */
+
+#define ARRAY_KLASS		6
+#define ARRAY_ID		IPCT_ACTION_ID(ARRAY_KLASS, 0, 0)
+
+#define ARRAY_HALF		1	/* 1 - 5 */
+#define ARRAY_BYTE		10	/* 10 - 13 */
+#define ARRAY_WIDE		20	/* 20 - 22 */
+#define ARRAY_WORD		30	/* 30 - 35 */
+
+#define HALF_COUNT		5
+#define BYTE_COUNT		4
+#define WIDE_COUNT		3
+#define WORD_COUNT		6
+
+#define MSG_SIZE		256
+
+struct array_params {
+	uint16_t half[HALF_COUNT];
+	int8_t byte[BYTE_COUNT];
+	uint64_t wide[WIDE_COUNT];
+	uint32_t word[WORD_COUNT];
+};
+
+IPCT_DECLARE_TUPLE_ELEMS(array_man,
+	IPCT_TUPLE_ELEM_ARRAY(ARRAY_WORD, ipct_type_uint32_value,
+			      offsetof(struct array_params, word),
+			      WORD_COUNT, 0, 1000),
+);
+
+IPCT_DECLARE_TUPLE_ELEMS(array_opt,
+	IPCT_TUPLE_ELEM_ARRAY(ARRAY_HALF, ipct_type_uint16_value,
+			      offsetof(struct array_params, half),
+			      HALF_COUNT, 0, 0xffff),
+	IPCT_TUPLE_ELEM_ARRAY(ARRAY_BYTE, ipct_type_int8_value,
+			      offsetof(struct array_params, byte),
+			      BYTE_COUNT, -100, 100),
+	IPCT_TUPLE_ELEM_ARRAY(ARRAY_WIDE, ipct_type_uint64_value,
+			      offsetof(struct array_params, wide),
+			      WIDE_COUNT, 0, -1UL),
+);
+
+IPCT_DECLARE_ACTION_DESC(array_params,
+		IPCT_TUPLES(array_man),
+		IPCT_TUPLES(array_opt),
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTIONS(array,
+		IPCT_ACTION(0, array_params),
+);
+
+IPCT_DECLARE_SUBCLASS(array, 0, array_actions);
+
+static const struct ipct_klass_def array_klass = {
+	.klass_id	= ARRAY_KLASS,
+	.num_subklasses	= 1,
+	.subklass	= &array_subclass,
+};
+
+/* strings can't be C arrays */
+struct string_params {
+	char name[4][8];
+};
+
+IPCT_DECLARE_TUPLE_ELEMS(string_man,
+	IPCT_TUPLE_ELEM_ARRAY(1, ipct_type_string,
+			      offsetof(struct string_params, name), 4, 8, 8),
+);
+
+IPCT_DECLARE_ACTION_DESC(string_params,
+		IPCT_TUPLES(string_man),
+		IPCT_NOTUPLES,
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTIONS(string,
+		IPCT_ACTION(0, string_params),
+);
+
+IPCT_DECLARE_SUBCLASS(string, 0, string_actions);
+
+static const struct ipct_klass_def string_klass = {
+	.klass_id	= ARRAY_KLASS + 1,
+	.num_subklasses	= 1,
+	.subklass	= &string_subclass,
+};
+
+static void array_init(struct array_params *params)
+{
+	int i;
+
+	for (i = 0; i < HALF_COUNT; i++)
+		params->half[i] = 0xf000 + i;
+	for (i = 0; i < BYTE_COUNT; i++)
+		params->byte[i] = -50 + i;
+	for (i = 0; i < WIDE_COUNT; i++)
+		params->wide[i] = 0x0123456789abcd00ULL + i;
+	for (i = 0; i < WORD_COUNT; i++)
+		params->word[i] = 500 + i;
+}
+
+static void test_layout(struct ipct_context *ipct)
+{
+	struct array_params in, out;
+	struct ipct_tuple *tuple;
+	char msg[MSG_SIZE];
+	int size;
+
+	array_init(&in);
+	size = ipct_ctx_msg_pack(ipct, ARRAY_ID, &in, sizeof(in), msg,
+				 sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_get_tuples((struct ipct_hdr *)msg) == 4);
+
+	tuple = test_msg_tuple(msg, size, ARRAY_HALF);
+	TEST_CHECK(tuple && tuple->type == IPCT_TUPLE_TYPE_HD_ARRAY &&
+		   tuple_data_count(tuple) == HALF_COUNT);
+	tuple = test_msg_tuple(msg, size, ARRAY_BYTE);
+	TEST_CHECK(tuple && tuple->type == IPCT_TUPLE_TYPE_HD_ARRAY &&
+		   tuple_data_count(tuple) == BYTE_COUNT);
+	tuple = test_msg_tuple(msg, size, ARRAY_WIDE);
+	TEST_CHECK(tuple && tuple->type == IPCT_TUPLE_TYPE_VAR_ARRAY &&
+		   tuple_data_count(tuple) == WIDE_COUNT);
+	tuple = test_msg_tuple(msg, size, ARRAY_WORD);
+	TEST_CHECK(tuple && tuple->type == IPCT_TUPLE_TYPE_STD_ARRAY &&
+		   tuple_data_count(tuple) == WORD_COUNT);
+
+	/* int8 elems are sign extended to 16 bit tuple data */
+	TEST_CHECK(*(int16_t *)test_msg_data(msg, size, ARRAY_BYTE) == -50);
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       NULL, NULL, NULL) == 0);
+	TEST_CHECK(!memcmp(&in, &out, sizeof(in)));
+}
+
+static void test_partial(struct ipct_context *ipct)
+{
+	struct array_params in, out;
+	struct sof_ipct_elems *elems;
+	struct ipct_elem_std *std;
+	struct ipct_hdr *hdr;
+	char msg[MSG_SIZE];
+	uint32_t *value;
+	int size;
+
+	array_init(&in);
+	size = ipct_ctx_msg_pack(ipct, ARRAY_ID, &in, sizeof(in), msg,
+				 sizeof(msg), 0, 0);
+
+	/* any array elem out of range */
+	value = test_msg_data(msg, size, ARRAY_WORD + WORD_COUNT - 1);
+	*value = 1001;
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       NULL, NULL, NULL) == -EINVAL);
+	*value = 1000;
+
+	/* mandatory array missing its last elem - the word array is last */
+	std = IPC_GET_STD_TUPLE(test_msg_tuple(msg, size, ARRAY_WORD));
+	hdr = (struct ipct_hdr *)msg;
+	elems = IPCT_HDR_GET_ELEM_PTR(hdr);
+	std->count--;
+	elems->size--;
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size - sizeof(uint32_t), &out,
+				       sizeof(out), NULL, NULL, NULL) ==
+		   -EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &array_klass) == 0);
+	test_layout(ipct);
+	test_partial(ipct);
+
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &string_klass) < 0);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Message batches - messages are packed back to back until the buffer is
+ * full and iterated in order. Micro messages carry their tuple inline and
+ * are told from nano messages by their header like ipct_msg_peek() does.
+ */
+
+#define BATCH_SIZE	1024
+#define BATCH_FILL	0xa5
+
+static void test_fill(void)
+{
+	struct test_params in, out;
+	struct ipct_msg_batch batch;
+	struct ipct_msg_iter iter;
+	uint8_t buf[BATCH_SIZE];
+	size_t msg_size, used;
+	void *msg;
+	int size, ret, count = 0, i;
+
+	test_params_init(&in);
+	size = ipct_msg_packed_size(TEST_ID(TEST_ACTION_PARAMS), 0, 0x22);
+	TEST_CHECK(size > 0);
+
+	memset(buf, BATCH_FILL, sizeof(buf));
+	TEST_CHECK(ipct_msg_batch_init(&batch, buf, sizeof(buf)) == 0);
+
+	do {
+		in.id = count;
+		ret = ipct_msg_batch_add(&batch, TEST_ID(TEST_ACTION_PARAMS),
+					 &in, sizeof(in), 0, 0x22);
+		if (ret > 0) {
+			TEST_CHECK(ret == size);
+			count++;
+		}
+	} while (ret > 0);
+
+	/* full batch is unchanged and nothing written past it */
+	TEST_CHECK(ret == -ENOSPC);
+	TEST_CHECK(count == BATCH_SIZE / size);
+	TEST_CHECK(batch.count == count);
+	used = ipct_msg_batch_size(&batch);
+	TEST_CHECK(used == count * size);
+	for (i = used; i < sizeof(buf); i++)
+		TEST_CHECK(buf[i] == BATCH_FILL);
+
+	/* other errors are not a full batch */
+	TEST_CHECK(ipct_msg_batch_add(&batch, TEST_ID(255), &in, sizeof(in), 0,
+				      0) == -EINVAL);
+
+	ipct_msg_iter_init(&iter, buf, used);
+	for (i = 0; i < count; i++) {
+		TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 1);
+		TEST_CHECK(msg_size == size);
+		TEST_CHECK(ipct_msg_unpack(msg, msg_size, &out, sizeof(out),
+					   NULL, NULL) == 0);
+		TEST_CHECK(out.id == i);
+	}
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 0);
+}
+
+/* std, micro, std, micro and nano messages back to back */
+static int pack_mixed(uint8_t *buf, size_t *sizes)
+{
+	struct test_params in;
+	int offset = 0, ret, i;
+
+	test_params_init(&in);
+
+	for (i = 0; i < 2; i++) {
+		ret = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in,
+				    sizeof(in), buf + offset,
+				    BATCH_SIZE - offset, 0, 0);
+		TEST_CHECK(ret > 0);
+		sizes[i * 2] = ret;
+		offset += ret;
+
+		ret = ipct_msg_pack_micro(TEST_ID(TEST_ACTION_BLOCK), 0, 10 + i,
+					  0x1234 + i, buf + offset,
+					  BATCH_SIZE - offset);
+		TEST_CHECK(ret == IPCT_MSG_MICRO_SIZE);
+		sizes[i * 2 + 1] = ret;
+		offset += ret;
+	}
+
+	ret = ipct_msg_pack_nano(TEST_ID(TEST_ACTION_LARGE), 0, buf + offset,
+				 BATCH_SIZE - offset);
+	TEST_CHECK(ret == IPCT_MSG_NANO_SIZE);
+	sizes[4] = ret;
+
+	return offset + ret;
+}
+
+static void test_micro(void)
+{
+	struct ipct_msg_info info;
+	struct ipct_msg_iter iter;
+	uint8_t buf[BATCH_SIZE];
+	uint32_t id, flags, tuple_id;
+	size_t sizes[5], msg_size;
+	uint16_t value;
+	void *msg;
+	int size, i;
+
+	size = pack_mixed(buf, sizes);
+
+	ipct_msg_iter_init(&iter, buf, size);
+	for (i = 0; i < 5; i++) {
+		TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 1);
+		TEST_CHECK(msg_size == sizes[i]);
+
+		/* peek sizes the message the same way in the whole batch */
+		TEST_CHECK(ipct_msg_peek(msg, buf + size - (uint8_t *)msg,
+					 &info) == 0);
+		TEST_CHECK(info.hdr_size + info.size == msg_size);
+
+		if (i == 1 || i == 3) {
+			TEST_CHECK(ipct_msg_unpack_micro(msg, msg_size, &id,
+							 &flags, &tuple_id,
+							 &value) == 0);
+			TEST_CHECK(id == TEST_ID(TEST_ACTION_BLOCK));
+			TEST_CHECK(tuple_id == 10 + i / 2);
+			TEST_CHECK(value == 0x1234 + i / 2);
+		}
+	}
+
+	TEST_CHECK(ipct_msg_classify(msg, msg_size) == IPCT_MSG_CLASS_NANO);
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 0);
+}
+
+/* nano message followed by a message whose first word looks like a tuple */
+static void test_nano_first(void)
+{
+	struct test_params in, out;
+	struct ipct_msg_iter iter;
+	uint8_t buf[BATCH_SIZE];
+	uint32_t id, flags;
+	size_t msg_size;
+	void *msg;
+	int ret, size;
+
+	test_params_init(&in);
+
+	/* klass 5 has the HD tuple type in its low bits */
+	ret = ipct_msg_pack_nano(IPCT_ACTION_ID(5, 0, 0), 0, buf, sizeof(buf));
+	TEST_CHECK(ret == IPCT_MSG_NANO_SIZE);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in),
+			     buf + ret, sizeof(buf) - ret, 0, 0);
+	TEST_CHECK(size > 0);
+	ret = ipct_msg_pack_micro(TEST_ID(TEST_ACTION_BLOCK), 0, 1, 2,
+				  buf + ret + size, sizeof(buf) - ret - size);
+	TEST_CHECK(ret == IPCT_MSG_MICRO_SIZE);
+
+	ipct_msg_iter_init(&iter, buf, IPCT_MSG_NANO_SIZE + size +
+			   IPCT_MSG_MICRO_SIZE);
+
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 1);
+	TEST_CHECK(msg_size == IPCT_MSG_NANO_SIZE);
+	TEST_CHECK(ipct_msg_unpack_nano(msg, msg_size, &id, &flags) == 0);
+	TEST_CHECK(id == IPCT_ACTION_ID(5, 0, 0));
+
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 1);
+	TEST_CHECK(msg_size == size);
+	TEST_CHECK(ipct_msg_unpack(msg, msg_size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 1);
+	TEST_CHECK(msg_size == IPCT_MSG_MICRO_SIZE);
+	TEST_CHECK(ipct_msg_classify(msg, msg_size) == IPCT_MSG_CLASS_MICRO);
+
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == 0);
+}
+
+static void test_malformed(void)
+{
+	struct ipct_msg_iter iter;
+	uint8_t buf[BATCH_SIZE];
+	size_t sizes[5], msg_size;
+	void *msg;
+
+	pack_mixed(buf, sizes);
+
+	/* std message cut short */
+	ipct_msg_iter_init(&iter, buf, sizes[0] - 4);
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == -EINVAL);
+
+	/* headers cut short */
+	ipct_msg_iter_init(&iter, buf, 2);
+	TEST_CHECK(ipct_msg_iter_next(&iter, &msg, &msg_size) == -EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_fill();
+	test_micro();
+	test_nano_first();
+	test_malformed();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Private data blocks - the C structure is copied as is, padded to a word,
+ * into flat and segmented buffers. Blocks that don't match the action are
+ * rejected.
+ */
+
+#define MSG_SIZE	64
+#define HDR_BYTES	(sizeof(struct ipct_hdr) + sizeof(struct sof_ipct_elems))
+
+static void test_round_trip(void)
+{
+	struct test_block in = {1, 2, 3}, out;
+	struct sof_ipct_elems *elems;
+	struct ipct_hdr *hdr;
+	uint8_t msg[MSG_SIZE];
+	uint32_t word;
+	int size;
+
+	memset(msg, 0xff, sizeof(msg));
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_BLOCK), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	TEST_CHECK(size == HDR_BYTES + 8);
+	TEST_CHECK(size == ipct_msg_packed_size(TEST_ID(TEST_ACTION_BLOCK), 0,
+						0));
+
+	hdr = (struct ipct_hdr *)msg;
+	elems = (struct sof_ipct_elems *)(hdr + 1);
+	TEST_CHECK(hdr->block && hdr->elems && !hdr->route);
+
+	/* block is header bit 29 and the vendor bits are left clear */
+	memcpy(&word, msg, sizeof(word));
+	TEST_CHECK((word >> 29) == 1);
+	TEST_CHECK(elems->num_tuples == 0 && elems->size == 2);
+	TEST_CHECK(!memcmp(msg + HDR_BYTES, &in, sizeof(in)));
+
+	/* padding is zeroed */
+	TEST_CHECK(msg[HDR_BYTES + 6] == 0 && msg[HDR_BYTES + 7] == 0);
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(!memcmp(&in, &out, sizeof(in)));
+
+	/* dest too small for the C structure */
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out) - 1, NULL,
+				   NULL) == -EINVAL);
+}
+
+/* pack into iovcnt segments of len bytes - all allocated to exact size */
+static int pack_iov(uint32_t id, void *src, size_t src_size, int iovcnt,
+		    size_t len, uint8_t *msg)
+{
+	struct ipct_iovec *iov = malloc(iovcnt * sizeof(*iov));
+	int i, ret;
+
+	for (i = 0; i < iovcnt; i++) {
+		iov[i].base = malloc(len);
+		iov[i].len = len;
+	}
+
+	ret = ipct_msg_pack_iov(id, src, src_size, iov, iovcnt, 0, 0);
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(msg + i * len, iov[i].base, len);
+		free(iov[i].base);
+	}
+	free(iov);
+
+	return ret;
+}
+
+static void test_iov(void)
+{
+	struct test_block_words words = {0x12345678, 0x9abcdef0}, words_out;
+	struct test_block in = {4, 5, 6}, out;
+	uint8_t flat[MSG_SIZE], msg[MSG_SIZE];
+	int size, len;
+
+	/* one segment of exactly the message size - no padding to write */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_BLOCK_WORDS), &words,
+			     sizeof(words), flat, sizeof(flat), 0, 0);
+	TEST_CHECK(size == HDR_BYTES + sizeof(words));
+	TEST_CHECK(pack_iov(TEST_ID(TEST_ACTION_BLOCK_WORDS), &words,
+			    sizeof(words), 1, size, msg) == size);
+	TEST_CHECK(!memcmp(flat, msg, size));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &words_out, sizeof(words_out),
+				   NULL, NULL) == 0);
+	TEST_CHECK(!memcmp(&words, &words_out, sizeof(words)));
+
+	/* padded block split over segments of every size */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_BLOCK), &in, sizeof(in), flat,
+			     sizeof(flat), 0, 0);
+	for (len = 1; len <= size; len++) {
+		if ((size + len - 1) / len > 16)
+			continue;
+
+		memset(msg, 0xff, sizeof(msg));
+		TEST_CHECK(pack_iov(TEST_ID(TEST_ACTION_BLOCK), &in, sizeof(in),
+				    (size + len - 1) / len, len, msg) == size);
+		TEST_CHECK(!memcmp(flat, msg, size));
+	}
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(!memcmp(&in, &out, sizeof(in)));
+
+	/* segments one byte short */
+	TEST_CHECK(pack_iov(TEST_ID(TEST_ACTION_BLOCK), &in, sizeof(in), 1,
+			    size - 1, msg) == -ENOSPC);
+}
+
+static void test_malformed(void)
+{
+	struct test_block in = {7, 8, 9}, out;
+	struct test_params params;
+	struct sof_ipct_elems *elems;
+	struct ipct_hdr *hdr;
+	uint8_t msg[MSG_SIZE], *exact;
+	uint8_t tuples[512];
+	int size, len;
+
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_BLOCK), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	hdr = (struct ipct_hdr *)msg;
+	elems = (struct sof_ipct_elems *)(hdr + 1);
+
+	/* block size must match the action */
+	elems->size = 1;
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	elems->size = 3;
+	TEST_CHECK(ipct_msg_unpack(msg, size + 4, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	elems->size = 2;
+
+	/* block action sent as tuples */
+	hdr->block = 0;
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	hdr->block = 1;
+
+	/* every prefix in a buffer of its exact size */
+	for (len = 0; len < size; len++) {
+		exact = malloc(len ? len : 1);
+		memcpy(exact, msg, len);
+		TEST_CHECK(ipct_msg_unpack(exact, len, &out, sizeof(out), NULL,
+					   NULL) < 0);
+		free(exact);
+	}
+
+	/* tuple action sent as a block */
+	test_params_init(&params);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &params,
+			     sizeof(params), tuples, sizeof(tuples), 0, 0);
+	TEST_CHECK(size > 0);
+	hdr = (struct ipct_hdr *)tuples;
+	hdr->block = 1;
+	TEST_CHECK(ipct_msg_unpack(tuples, size, &params, sizeof(params), NULL,
+				   NULL) == -EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_round_trip();
+	test_iov();
+	test_malformed();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * Codec ops - messages in the packed layout are unpacked by the compiled
+ * fast path, any other tuple order by the generic path. Both give the same
+ * C structure and reject the same bad values.
+ */
+
+#define MSG_SIZE	512
+
+static void test_paths(void)
+{
+	struct test_params in, out;
+	char msg[MSG_SIZE], reordered[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_get_tuples((struct ipct_hdr *)msg) <= TEST_MAX_TUPLES);
+
+	/* packed layout */
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+
+	/* any other order */
+	test_msg_reverse(msg, reordered);
+	TEST_CHECK(memcmp(msg, reordered, size));
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(reordered, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+/* out of range value of tuple ID in packed and reordered layouts */
+static void test_bad_value(uint32_t id, const void *value, size_t bytes)
+{
+	struct test_params in, out;
+	char msg[MSG_SIZE], reordered[MSG_SIZE];
+	void *data;
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	data = test_msg_data(msg, size, id);
+	TEST_CHECK(data != NULL);
+	if (!data)
+		return;
+
+	memcpy(data, value, bytes);
+	test_msg_reverse(msg, reordered);
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	TEST_CHECK(ipct_msg_unpack(reordered, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+}
+
+static void test_range(void)
+{
+	uint16_t channels = 9, flags = 0x10, map = 101;
+	int16_t level = -21;
+	int32_t offset = 1001;
+	uint32_t id = 101;
+	float gain = 10.5f;
+
+	/* uint32, int32, uint16, mask, int8, float and array elem limits */
+	test_bad_value(TEST_PARAMS_ID, &id, sizeof(id));
+	test_bad_value(TEST_PARAMS_OFFSET, &offset, sizeof(offset));
+	test_bad_value(TEST_PARAMS_CHANNELS, &channels, sizeof(channels));
+	test_bad_value(TEST_PARAMS_FLAGS, &flags, sizeof(flags));
+	test_bad_value(TEST_PARAMS_LEVEL, &level, sizeof(level));
+	test_bad_value(TEST_PARAMS_GAIN, &gain, sizeof(gain));
+	test_bad_value(TEST_PARAMS_MAP + TEST_MAP_SIZE - 1, &map, sizeof(map));
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_paths();
+	test_range();
+
+	return TEST_RESULT();
+}
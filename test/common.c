@@ -0,0 +1,217 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <private/header.h>
+#include <private/message.h>
+
+#include "test.h"
+
+int test_failures;
+
+void test_quiet(void)
+{
+	if (!freopen("/dev/null", "w", stdout))
+		fprintf(stderr, "warning: can't silence stdout\n");
+}
+
+/* mandatory tuples - struct test_params */
+IPCT_DECLARE_TUPLE_ELEMS(test_params_man,
+	IPCT_TUPLE_ELEM(TEST_PARAMS_ID, ipct_type_uint32_value,
+			offsetof(struct test_params, id), 0, 100),
+	IPCT_TUPLE_ELEM(TEST_PARAMS_OFFSET, ipct_type_int32_value,
+			offsetof(struct test_params, offset), -1000, 1000),
+	IPCT_TUPLE_ELEM(TEST_PARAMS_CHANNELS, ipct_type_uint16_value,
+			offsetof(struct test_params, channels), 1, 8),
+);
+
+/* optional tuples - struct test_params */
+IPCT_DECLARE_TUPLE_ELEMS(test_params_opt,
+	IPCT_TUPLE_ELEM(TEST_PARAMS_FLAGS, ipct_type_uint8_mask,
+			offsetof(struct test_params, flags), 0x0f, 0),
+	IPCT_TUPLE_ELEM(TEST_PARAMS_GAIN, ipct_type_float_value,
+			offsetof(struct test_params, gain), 0, 10),
+	IPCT_TUPLE_ELEM(TEST_PARAMS_STAMP, ipct_type_uint64_value,
+			offsetof(struct test_params, stamp), 0, -1UL),
+	IPCT_TUPLE_ELEM(TEST_PARAMS_NAME, ipct_type_string,
+			offsetof(struct test_params, name),
+			TEST_NAME_SIZE, TEST_NAME_SIZE),
+	IPCT_TUPLE_ELEM(TEST_PARAMS_LEVEL, ipct_type_int8_value,
+			offsetof(struct test_params, level), -20, 20),
+	IPCT_TUPLE_ELEM_ARRAY(TEST_PARAMS_MAP, ipct_type_uint16_value,
+			      offsetof(struct test_params, map),
+			      TEST_MAP_SIZE, 0, 100),
+);
+
+/* mandatory tuples - struct test_route */
+IPCT_DECLARE_TUPLE_ELEMS(test_route_man,
+	IPCT_TUPLE_ELEM(TEST_ROUTE_A, ipct_type_uint32_value,
+			offsetof(struct test_route, a), 0, 1000),
+	IPCT_TUPLE_ELEM(TEST_ROUTE_B, ipct_type_uint32_value,
+			offsetof(struct test_route, b), 0, -1U),
+);
+
+IPCT_DECLARE_SUBACTION_DESC(test_params,
+	IPCT_DECLARE_SUBACTION_ELEM(route, test_params,
+			IPCT_TUPLES(test_route_man),
+			IPCT_NOTUPLES,
+			TEST_ROUTE_SIZE, IPCT_NOSUBACTION));
+
+IPCT_DECLARE_ACTION_DESC(test_params,
+		IPCT_TUPLES(test_params_man),
+		IPCT_TUPLES(test_params_opt),
+		0, IPCT_SUBACTION(test_params));
+
+/* private data block - struct test_block */
+IPCT_DECLARE_ACTION_DESC(test_block,
+		IPCT_NOTUPLES,
+		IPCT_NOTUPLES,
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTION_DESC(test_block_words,
+		IPCT_NOTUPLES,
+		IPCT_NOTUPLES,
+		0, IPCT_NOSUBACTION);
+
+/* every other tuple ID so each word is its own tuple */
+#define TEST_LARGE_ELEM(i)						\
+	IPCT_TUPLE_ELEM((i) * 2, ipct_type_uint32_value,		\
+			offsetof(struct test_large, v[i]), 0, -1U)
+
+IPCT_DECLARE_TUPLE_ELEMS(test_large_man,
+	TEST_LARGE_ELEM(0), TEST_LARGE_ELEM(1), TEST_LARGE_ELEM(2),
+	TEST_LARGE_ELEM(3), TEST_LARGE_ELEM(4), TEST_LARGE_ELEM(5),
+	TEST_LARGE_ELEM(6), TEST_LARGE_ELEM(7), TEST_LARGE_ELEM(8),
+	TEST_LARGE_ELEM(9), TEST_LARGE_ELEM(10), TEST_LARGE_ELEM(11),
+	TEST_LARGE_ELEM(12), TEST_LARGE_ELEM(13), TEST_LARGE_ELEM(14),
+	TEST_LARGE_ELEM(15),
+);
+
+IPCT_DECLARE_ACTION_DESC(test_large,
+		IPCT_TUPLES(test_large_man),
+		IPCT_NOTUPLES,
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTIONS(test,
+		IPCT_ACTION(TEST_ACTION_PARAMS, test_params),
+		IPCT_ACTION_BLOCK(TEST_ACTION_BLOCK, test_block),
+		IPCT_ACTION(TEST_ACTION_LARGE, test_large),
+		IPCT_ACTION_BLOCK(TEST_ACTION_BLOCK_WORDS, test_block_words),
+);
+
+IPCT_DECLARE_SUBCLASS(test, TEST_SUBKLASS, test_actions);
+
+const struct ipct_klass_def test_klass = {
+	.klass_id	= TEST_KLASS,
+	.num_subklasses	= 1,
+	.subklass	= &test_subclass,
+};
+
+struct ipct_klass_list builder_klasses = {
+	.num_klasses = 1,
+	.klasses = &test_klass,
+};
+
+void test_params_init(struct test_params *params)
+{
+	int i;
+
+	memset(params, 0, sizeof(*params));
+	params->id = 42;
+	params->offset = -500;
+	params->channels = 2;
+	params->flags = 0x5;
+	params->level = -7;
+	params->gain = 1.5f;
+	params->stamp = 0x0123456789abcdefULL;
+	strcpy(params->name, "test");
+
+	for (i = 0; i < TEST_MAP_SIZE; i++)
+		params->map[i] = i * 10;
+
+	for (i = 0; i < TEST_ROUTE_SIZE; i++) {
+		params->route[i].a = 100 + i;
+		params->route[i].b = 0xdead0000 + i;
+	}
+}
+
+/* compare members - padding is not packed */
+int test_params_equal(const struct test_params *a,
+		      const struct test_params *b)
+{
+	return a->id == b->id && a->offset == b->offset &&
+		a->channels == b->channels && a->flags == b->flags &&
+		a->level == b->level && a->gain == b->gain &&
+		a->stamp == b->stamp &&
+		!memcmp(a->name, b->name, sizeof(a->name)) &&
+		!memcmp(a->map, b->map, sizeof(a->map)) &&
+		!memcmp(a->route, b->route, sizeof(a->route));
+}
+
+void test_large_init(struct test_large *large)
+{
+	int i;
+
+	for (i = 0; i < TEST_LARGE_WORDS; i++)
+		large->v[i] = 0x1000 + i;
+}
+
+struct ipct_tuple *test_msg_tuple(void *msg, size_t size, uint32_t id)
+{
+	struct ipct_hdr *hdr = msg;
+	struct ipct_tuple *tuple = IPCT_HDR_GET_TUPLE(hdr);
+	uint32_t i;
+
+	for (i = 0; i < ipct_get_tuples(hdr) && (void *)tuple < msg + size;
+	     i++) {
+		if (tuple->id == id)
+			return tuple;
+		tuple = (struct ipct_tuple *)ipc_next_tuple(tuple);
+	}
+
+	return NULL;
+}
+
+void *test_msg_data(void *msg, size_t size, uint32_t id)
+{
+	struct ipct_hdr *hdr = msg;
+	struct ipct_tuple *tuple = IPCT_HDR_GET_TUPLE(hdr);
+	uint32_t i;
+
+	for (i = 0; i < ipct_get_tuples(hdr) && (void *)tuple < msg + size;
+	     i++) {
+		if (tuple->type != IPCT_TUPLE_TYPE_TUPLE_ARRAY &&
+		    id >= tuple->id && id < tuple->id + tuple_data_count(tuple))
+			return tuple_get_data(tuple, id - tuple->id);
+		tuple = (struct ipct_tuple *)ipc_next_tuple(tuple);
+	}
+
+	return NULL;
+}
+
+void test_msg_reverse(const void *msg, void *reordered)
+{
+	const struct ipct_hdr *hdr = msg;
+	const struct ipct_tuple *tuple[TEST_MAX_TUPLES];
+	uint32_t hdr_size = IPCT_HDR_GET_HDR_SIZE(hdr);
+	uint32_t num = ipct_get_tuples((struct ipct_hdr *)hdr);
+	uint32_t offset = hdr_size;
+	int i;
+
+	memcpy(reordered, msg, hdr_size);
+
+	tuple[0] = msg + hdr_size;
+	for (i = 1; i < num; i++)
+		tuple[i] = ipc_next_tuple(tuple[i - 1]);
+
+	for (i = num - 1; i >= 0; i--) {
+		memcpy(reordered + offset, tuple[i], tuple_size(tuple[i]));
+		offset += tuple_size(tuple[i]);
+	}
+}
@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "test.h"
+
+/*
+ * Registry concurrency - readers pack and unpack while a writer registers
+ * and unregisters another klass on the same context. Lookups never fail for
+ * the klass that stays registered and the churned klass is either found
+ * whole or not at all.
+ */
+
+#define CHURN_KLASS		9
+#define CHURN_ID		IPCT_ACTION_ID(CHURN_KLASS, 0, 0)
+
+#define NUM_READERS		4
+#define READER_LOOPS		1000
+#define WRITER_LOOPS		200
+#define MSG_SIZE		512
+
+struct churn_params {
+	uint32_t a;
+	uint32_t b;
+};
+
+IPCT_DECLARE_TUPLE_ELEMS(churn_man,
+	IPCT_TUPLE_ELEM(1, ipct_type_uint32_value,
+			offsetof(struct churn_params, a), 0, -1U),
+	IPCT_TUPLE_ELEM(3, ipct_type_uint32_value,
+			offsetof(struct churn_params, b), 0, -1U),
+);
+
+IPCT_DECLARE_ACTION_DESC(churn_params,
+		IPCT_TUPLES(churn_man),
+		IPCT_NOTUPLES,
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTIONS(churn,
+		IPCT_ACTION(0, churn_params),
+);
+
+IPCT_DECLARE_SUBCLASS(churn, 0, churn_actions);
+
+static const struct ipct_klass_def churn_klass = {
+	.klass_id	= CHURN_KLASS,
+	.num_subklasses	= 1,
+	.subklass	= &churn_subclass,
+};
+
+struct reader {
+	pthread_t thread;
+	struct ipct_context *ipct;
+	int index;
+	int failures;
+};
+
+static atomic_int writer_done;
+
+static void *reader_run(void *data)
+{
+	struct reader *reader = data;
+	struct test_params in, out;
+	struct churn_params cin, cout;
+	char msg[MSG_SIZE];
+	int i, size;
+
+	test_params_init(&in);
+
+	/* keep reading until the writer is done */
+	for (i = 0; i < READER_LOOPS || !atomic_load(&writer_done); i++) {
+		in.id = (reader->index * 7 + i) % 100;
+		size = ipct_ctx_msg_pack(reader->ipct,
+					 TEST_ID(TEST_ACTION_PARAMS), &in,
+					 sizeof(in), msg, sizeof(msg), 0, 0);
+		if (size <= 0 ||
+		    ipct_ctx_msg_unpack(reader->ipct, msg, size, &out,
+					sizeof(out), NULL, NULL, NULL) ||
+		    !test_params_equal(&in, &out))
+			reader->failures++;
+
+		/* churned klass is either there or not */
+		cin.a = i;
+		cin.b = ~i;
+		size = ipct_ctx_msg_pack(reader->ipct, CHURN_ID, &cin,
+					 sizeof(cin), msg, sizeof(msg), 0, 0);
+		if (size == -EINVAL)
+			continue;
+		if (size <= 0) {
+			reader->failures++;
+			continue;
+		}
+
+		/* it may have gone between pack and unpack */
+		memset(&cout, 0, sizeof(cout));
+		switch (ipct_ctx_msg_unpack(reader->ipct, msg, size, &cout,
+					    sizeof(cout), NULL, NULL, NULL)) {
+		case 0:
+			if (cout.a != cin.a || cout.b != cin.b)
+				reader->failures++;
+			break;
+		case -EINVAL:
+			break;
+		default:
+			reader->failures++;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *writer_run(void *data)
+{
+	struct ipct_context *ipct = data;
+	int i, failures = 0;
+
+	for (i = 0; i < WRITER_LOOPS; i++) {
+		if (ipct_ctx_register_klass(ipct, &churn_klass) ||
+		    ipct_ctx_unregister_klass(ipct, CHURN_KLASS))
+			failures++;
+	}
+
+	atomic_store(&writer_done, 1);
+	return (void *)(uintptr_t)failures;
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+	struct reader readers[NUM_READERS];
+	pthread_t writer;
+	void *writer_failures;
+	int i;
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+
+	for (i = 0; i < NUM_READERS; i++) {
+		memset(&readers[i], 0, sizeof(readers[i]));
+		readers[i].ipct = ipct;
+		readers[i].index = i;
+		TEST_CHECK(pthread_create(&readers[i].thread, NULL, reader_run,
+					  &readers[i]) == 0);
+	}
+	TEST_CHECK(pthread_create(&writer, NULL, writer_run, ipct) == 0);
+
+	TEST_CHECK(pthread_join(writer, &writer_failures) == 0);
+	TEST_CHECK(writer_failures == NULL);
+
+	for (i = 0; i < NUM_READERS; i++) {
+		TEST_CHECK(pthread_join(readers[i].thread, NULL) == 0);
+		TEST_CHECK(readers[i].failures == 0);
+	}
+
+	/* klass is gone once unregistered and can be registered again */
+	TEST_CHECK(ipct_ctx_msg_max_size(ipct, CHURN_ID) == -EINVAL);
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &churn_klass) == 0);
+	TEST_CHECK(ipct_ctx_msg_max_size(ipct, CHURN_ID) > 0);
+	TEST_CHECK(ipct_ctx_unregister_klass(ipct, CHURN_KLASS) == 0);
+	TEST_CHECK(ipct_ctx_unregister_klass(ipct, CHURN_KLASS) < 0);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
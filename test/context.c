@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "test.h"
+
+/*
+ * Contexts - each context has its own registry and statistics. Klasses
+ * registered on one context are not seen by another and contexts driven
+ * from different threads only count their own messages.
+ */
+
+#define MSG_SIZE	512
+#define NUM_THREADS	4
+#define THREAD_LOOPS	1000
+
+static void test_registry(void)
+{
+	struct ipct_context *a = ipct_ctx_create(&builder_klasses);
+	struct ipct_context *b = ipct_ctx_create(NULL);
+	struct test_params in, out;
+	char msg[MSG_SIZE];
+	int size;
+
+	TEST_CHECK(a != NULL && b != NULL);
+	if (!a || !b)
+		goto out;
+
+	/* b starts empty */
+	TEST_CHECK(ipct_ctx_msg_max_size(a, TEST_ID(TEST_ACTION_PARAMS)) > 0);
+	TEST_CHECK(ipct_ctx_msg_max_size(b, TEST_ID(TEST_ACTION_PARAMS)) ==
+		   -EINVAL);
+
+	test_params_init(&in);
+	size = ipct_ctx_msg_pack(a, TEST_ID(TEST_ACTION_PARAMS), &in,
+				 sizeof(in), msg, sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_ctx_msg_unpack(b, msg, size, &out, sizeof(out), NULL,
+				       NULL, NULL) == -EINVAL);
+
+	/* registering on b does not change a */
+	TEST_CHECK(ipct_ctx_register_klass(b, &test_klass) == 0);
+	TEST_CHECK(ipct_ctx_msg_unpack(b, msg, size, &out, sizeof(out), NULL,
+				       NULL, NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+
+	TEST_CHECK(ipct_ctx_unregister_klass(a, TEST_KLASS) == 0);
+	TEST_CHECK(ipct_ctx_msg_max_size(a, TEST_ID(TEST_ACTION_PARAMS)) ==
+		   -EINVAL);
+	TEST_CHECK(ipct_ctx_msg_max_size(b, TEST_ID(TEST_ACTION_PARAMS)) > 0);
+
+out:
+	if (a)
+		ipct_ctx_free(a);
+	if (b)
+		ipct_ctx_free(b);
+}
+
+static void test_stats(void)
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+	struct ipct_ctx_stats stats;
+	struct test_params in, out;
+	char msg[MSG_SIZE];
+	int size, i;
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return;
+
+	ipct_ctx_get_stats(ipct, &stats);
+	TEST_CHECK(stats.msgs_packed == 0 && stats.msgs_unpacked == 0);
+	TEST_CHECK(stats.bytes_packed == 0 && stats.bytes_unpacked == 0);
+	TEST_CHECK(stats.pack_errors == 0 && stats.unpack_errors == 0);
+
+	test_params_init(&in);
+	for (i = 0; i < 3; i++) {
+		size = ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS),
+					 &in, sizeof(in), msg, sizeof(msg),
+					 0, 0);
+		TEST_CHECK(size > 0);
+		TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out,
+					       sizeof(out), NULL, NULL,
+					       NULL) == 0);
+	}
+
+	/* unknown action and a truncated message */
+	TEST_CHECK(ipct_ctx_msg_pack(ipct, TEST_ID(255), &in, sizeof(in), msg,
+				     sizeof(msg), 0, 0) == -EINVAL);
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size - 4, &out, sizeof(out),
+				       NULL, NULL, NULL) == -EINVAL);
+
+	ipct_ctx_get_stats(ipct, &stats);
+	TEST_CHECK(stats.msgs_packed == 3 && stats.msgs_unpacked == 3);
+	TEST_CHECK(stats.bytes_packed == 3 * size);
+	TEST_CHECK(stats.bytes_unpacked == 3 * size);
+	TEST_CHECK(stats.pack_errors == 1 && stats.unpack_errors == 1);
+
+	ipct_ctx_free(ipct);
+}
+
+struct worker {
+	pthread_t thread;
+	struct ipct_context *ipct;
+	int size;
+	int failures;
+};
+
+static void *worker_run(void *data)
+{
+	struct worker *worker = data;
+	struct test_params in, out;
+	char msg[MSG_SIZE];
+	int i, size;
+
+	test_params_init(&in);
+
+	for (i = 0; i < THREAD_LOOPS; i++) {
+		size = ipct_ctx_msg_pack(worker->ipct,
+					 TEST_ID(TEST_ACTION_PARAMS), &in,
+					 sizeof(in), msg, sizeof(msg), 0, 0);
+		if (size <= 0 ||
+		    ipct_ctx_msg_unpack(worker->ipct, msg, size, &out,
+					sizeof(out), NULL, NULL, NULL))
+			worker->failures++;
+		worker->size = size;
+	}
+
+	return NULL;
+}
+
+/* a context per thread - nothing is shared */
+static void test_threads(void)
+{
+	struct worker workers[NUM_THREADS];
+	struct ipct_ctx_stats stats;
+	int i;
+
+	for (i = 0; i < NUM_THREADS; i++) {
+		memset(&workers[i], 0, sizeof(workers[i]));
+		workers[i].ipct = ipct_ctx_create(&builder_klasses);
+		TEST_CHECK(workers[i].ipct != NULL);
+		if (!workers[i].ipct)
+			return;
+	}
+
+	for (i = 0; i < NUM_THREADS; i++)
+		TEST_CHECK(pthread_create(&workers[i].thread, NULL, worker_run,
+					  &workers[i]) == 0);
+
+	for (i = 0; i < NUM_THREADS; i++) {
+		TEST_CHECK(pthread_join(workers[i].thread, NULL) == 0);
+		TEST_CHECK(workers[i].failures == 0);
+
+		ipct_ctx_get_stats(workers[i].ipct, &stats);
+		TEST_CHECK(stats.msgs_packed == THREAD_LOOPS);
+		TEST_CHECK(stats.msgs_unpacked == THREAD_LOOPS);
+		TEST_CHECK(stats.bytes_packed ==
+			   (uint64_t)THREAD_LOOPS * workers[i].size);
+		TEST_CHECK(stats.pack_errors == 0 && stats.unpack_errors == 0);
+
+		ipct_ctx_free(workers[i].ipct);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_registry();
+	test_stats();
+	test_threads();
+
+	return TEST_RESULT();
+}
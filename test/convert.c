@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Elem converters - every data type is unpacked into its C member width,
+ * 8 bit types from 16 bit tuple data and strings copied up to their length
+ * with the rest of the member zeroed.
+ */
+
+#define CONV_KLASS		8
+#define CONV_ID			IPCT_ACTION_ID(CONV_KLASS, 0, 0)
+
+#define CONV_S8			0
+#define CONV_U8			2
+#define CONV_S16		4
+#define CONV_BOOL		6
+#define CONV_ENUM		8
+#define CONV_S64		10
+#define CONV_DOUBLE		12
+#define CONV_UUID		14
+#define CONV_NAME		16
+
+#define CONV_NAME_LEN		4
+#define CONV_NAME_SIZE		8
+
+#define MSG_SIZE		256
+#define DEST_FILL		0x5a
+
+/* IDs are not sequential so every elem has its own tuple */
+struct conv_params {
+	int8_t s8;
+	uint8_t u8;
+	int16_t s16;
+	uint16_t on;
+	uint32_t mode;
+	int64_t s64;
+	double ratio;
+	uint32_t uuid[4];
+	char name[CONV_NAME_SIZE];
+};
+
+IPCT_DECLARE_TUPLE_ELEMS(conv_man,
+	IPCT_TUPLE_ELEM(CONV_S8, ipct_type_int8_value,
+			offsetof(struct conv_params, s8), -100, 100),
+	IPCT_TUPLE_ELEM(CONV_U8, ipct_type_uint8_value,
+			offsetof(struct conv_params, u8), 0, 0xff),
+	IPCT_TUPLE_ELEM(CONV_S16, ipct_type_int16_value,
+			offsetof(struct conv_params, s16), -30000, 30000),
+	IPCT_TUPLE_ELEM(CONV_BOOL, ipct_type_boolean,
+			offsetof(struct conv_params, on), 0, 1),
+	IPCT_TUPLE_ELEM(CONV_ENUM, ipct_type_enum,
+			offsetof(struct conv_params, mode), 0, 3),
+);
+
+IPCT_DECLARE_TUPLE_ELEMS(conv_opt,
+	IPCT_TUPLE_ELEM(CONV_S64, ipct_type_int64_value,
+			offsetof(struct conv_params, s64), -(1L << 40), 1L << 40),
+	IPCT_TUPLE_ELEM(CONV_DOUBLE, ipct_type_double_value,
+			offsetof(struct conv_params, ratio), 0, 1),
+	IPCT_TUPLE_ELEM(CONV_UUID, ipct_type_uuid,
+			offsetof(struct conv_params, uuid), 0, 0),
+	IPCT_TUPLE_ELEM(CONV_NAME, ipct_type_string,
+			offsetof(struct conv_params, name),
+			CONV_NAME_LEN, CONV_NAME_SIZE),
+);
+
+IPCT_DECLARE_ACTION_DESC(conv_params,
+		IPCT_TUPLES(conv_man),
+		IPCT_TUPLES(conv_opt),
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTIONS(conv,
+		IPCT_ACTION(0, conv_params),
+);
+
+IPCT_DECLARE_SUBCLASS(conv, 0, conv_actions);
+
+static const struct ipct_klass_def conv_klass = {
+	.klass_id	= CONV_KLASS,
+	.num_subklasses	= 1,
+	.subklass	= &conv_subclass,
+};
+
+static void conv_init(struct conv_params *params)
+{
+	memset(params, 0, sizeof(*params));
+	params->s8 = -5;
+	params->u8 = 0xf0;
+	params->s16 = -12345;
+	params->on = 1;
+	params->mode = 2;
+	params->s64 = -(1L << 35);
+	params->ratio = 0.125;
+	params->uuid[0] = 0x01234567;
+	params->uuid[1] = 0x89abcdef;
+	params->uuid[2] = 0xfedcba98;
+	params->uuid[3] = 0x76543210;
+	strcpy(params->name, "abcdefg");
+}
+
+static int conv_pack(struct ipct_context *ipct, void *msg)
+{
+	struct conv_params in;
+	int size;
+
+	conv_init(&in);
+	size = ipct_ctx_msg_pack(ipct, CONV_ID, &in, sizeof(in), msg, MSG_SIZE,
+				 0, 0);
+	TEST_CHECK(size > 0);
+	return size;
+}
+
+static void test_values(struct ipct_context *ipct)
+{
+	struct conv_params in, out;
+	char msg[MSG_SIZE];
+	int size;
+
+	conv_init(&in);
+	size = conv_pack(ipct, msg);
+
+	/* 8 bit values are 16 bit tuple data - int8 is sign extended */
+	TEST_CHECK(*(int16_t *)test_msg_data(msg, size, CONV_S8) == -5);
+	TEST_CHECK(*(uint16_t *)test_msg_data(msg, size, CONV_U8) == 0xf0);
+
+	memset(&out, DEST_FILL, sizeof(out));
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       NULL, NULL, NULL) == 0);
+	TEST_CHECK(out.s8 == in.s8);
+	TEST_CHECK(out.u8 == in.u8);
+	TEST_CHECK(out.s16 == in.s16);
+	TEST_CHECK(out.on == in.on);
+	TEST_CHECK(out.mode == in.mode);
+	TEST_CHECK(out.s64 == in.s64);
+	TEST_CHECK(out.ratio == in.ratio);
+	TEST_CHECK(!memcmp(out.uuid, in.uuid, sizeof(in.uuid)));
+
+	/* string copied up to its length and the rest zeroed */
+	TEST_CHECK(!memcmp(out.name, "abcd\0\0\0\0", CONV_NAME_SIZE));
+}
+
+/* out of range tuple data of tuple ID */
+static void test_bad_value(struct ipct_context *ipct, uint32_t id,
+			   const void *value, size_t bytes)
+{
+	struct conv_params out;
+	char msg[MSG_SIZE];
+	void *data;
+	int size;
+
+	size = conv_pack(ipct, msg);
+	data = test_msg_data(msg, size, id);
+	TEST_CHECK(data != NULL);
+	if (!data)
+		return;
+
+	memcpy(data, value, bytes);
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       NULL, NULL, NULL) == -EINVAL);
+}
+
+static void test_range(struct ipct_context *ipct)
+{
+	int16_t s8 = -101, s16 = -30001;
+	uint16_t u8 = 0x100, on = 2;
+	int64_t s64 = (1L << 40) + 1;
+	uint32_t mode = 4;
+	double ratio = 1.5;
+
+	test_bad_value(ipct, CONV_S8, &s8, sizeof(s8));
+	test_bad_value(ipct, CONV_U8, &u8, sizeof(u8));
+	test_bad_value(ipct, CONV_S16, &s16, sizeof(s16));
+	test_bad_value(ipct, CONV_BOOL, &on, sizeof(on));
+	test_bad_value(ipct, CONV_ENUM, &mode, sizeof(mode));
+	test_bad_value(ipct, CONV_S64, &s64, sizeof(s64));
+	test_bad_value(ipct, CONV_DOUBLE, &ratio, sizeof(ratio));
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &conv_klass) == 0);
+	test_values(ipct);
+	test_range(ipct);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
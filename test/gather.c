@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Gather pack - top level subaction C arrays read from their own source
+ * give the same message as the whole C structure, and the action source
+ * only has to hold the members that are not gathered.
+ */
+
+#define MSG_SIZE	512
+#define ROUTE_OFFSET	offsetof(struct test_params, route)
+
+static void test_same_msg(void)
+{
+	struct test_params in, out, part;
+	struct test_route route[TEST_ROUTE_SIZE];
+	struct ipct_gather gather;
+	char flat[MSG_SIZE], msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in),
+			     flat, sizeof(flat), 0, 0);
+	TEST_CHECK(size > 0);
+
+	/* routes only live in their own array */
+	memcpy(&part, &in, sizeof(part));
+	memset(part.route, 0, sizeof(part.route));
+	memcpy(route, in.route, sizeof(route));
+	gather.offset = ROUTE_OFFSET;
+	gather.src = route;
+
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &part,
+					ROUTE_OFFSET, &gather, 1, msg,
+					sizeof(msg), 0, 0) == size);
+	TEST_CHECK(!memcmp(msg, flat, size));
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+
+	/* routed messages too */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in),
+			     flat, sizeof(flat), IPCT_FLAGS_ROUTE, 0x22);
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &part,
+					ROUTE_OFFSET, &gather, 1, msg,
+					sizeof(msg), IPCT_FLAGS_ROUTE,
+					0x22) == size);
+	TEST_CHECK(!memcmp(msg, flat, size));
+
+	/* no gather is a normal pack */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in),
+			     flat, sizeof(flat), 0, 0);
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &in,
+					sizeof(in), NULL, 0, msg, sizeof(msg),
+					0, 0) == size);
+	TEST_CHECK(!memcmp(msg, flat, size));
+}
+
+static void test_bad_gather(void)
+{
+	struct test_route route[TEST_ROUTE_SIZE];
+	struct test_params params;
+	struct test_block block;
+	struct ipct_gather gather;
+	char msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&params);
+	memcpy(route, params.route, sizeof(route));
+	gather.src = route;
+
+	/* not a subaction */
+	gather.offset = offsetof(struct test_params, map);
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &params,
+					sizeof(params), &gather, 1, msg,
+					sizeof(msg), 0, 0) == -EINVAL);
+
+	/* no source */
+	gather.offset = ROUTE_OFFSET;
+	gather.src = NULL;
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &params,
+					sizeof(params), &gather, 1, msg,
+					sizeof(msg), 0, 0) == -EINVAL);
+
+	/* routes not gathered so the source is too small */
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &params,
+					ROUTE_OFFSET, NULL, 0, msg,
+					sizeof(msg), 0, 0) == -EINVAL);
+
+	/* negative count */
+	gather.src = route;
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &params,
+					sizeof(params), &gather, -1, msg,
+					sizeof(msg), 0, 0) == -EINVAL);
+
+	/* dest too small */
+	size = ipct_msg_packed_size(TEST_ID(TEST_ACTION_PARAMS), 0, 0);
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_PARAMS), &params,
+					ROUTE_OFFSET, &gather, 1, msg,
+					size - 1, 0, 0) == -ENOSPC);
+
+	/* data blocks have no subactions */
+	memset(&block, 0, sizeof(block));
+	TEST_CHECK(ipct_msg_pack_gather(TEST_ID(TEST_ACTION_BLOCK), &block,
+					sizeof(block), &gather, 1, msg,
+					sizeof(msg), 0, 0) == -EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_same_msg();
+	test_bad_gather();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Tuple ID index - dense and sparse (hashed) tuple IDs find their elem and
+ * no other ID does. Actions with tuple IDs used twice are rejected.
+ */
+
+#define INDEX_KLASS		2
+#define INDEX_ACTION_SPARSE	0
+#define INDEX_ACTION_DENSE	1
+#define INDEX_ID(action)	IPCT_ACTION_ID(INDEX_KLASS, 0, action)
+
+#define MSG_SIZE		256
+#define NUM_IDS			4
+#define UNUSED			0x5a5a5a5a
+
+struct index_words {
+	uint32_t v[NUM_IDS];
+};
+
+static const uint16_t sparse_ids[NUM_IDS] = {1, 700, 3000, IPCT_TUPLE_MAX_ID};
+static const uint16_t dense_ids[NUM_IDS] = {10, 12, 14, 16};
+
+#define INDEX_ELEM(tid, i)						\
+	IPCT_TUPLE_ELEM(tid, ipct_type_uint32_value,			\
+			offsetof(struct index_words, v[i]), 0, -1U)
+
+IPCT_DECLARE_TUPLE_ELEMS(sparse_man,
+	INDEX_ELEM(1, 0), INDEX_ELEM(700, 1),
+);
+
+IPCT_DECLARE_TUPLE_ELEMS(sparse_opt,
+	INDEX_ELEM(3000, 2), INDEX_ELEM(IPCT_TUPLE_MAX_ID, 3),
+);
+
+IPCT_DECLARE_ACTION_DESC(index_words,
+		IPCT_TUPLES(sparse_man),
+		IPCT_TUPLES(sparse_opt),
+		0, IPCT_NOSUBACTION);
+
+/* same C structure with dense IDs - not sequential so each has a tuple */
+IPCT_DECLARE_TUPLE_ELEMS(dense_man,
+	INDEX_ELEM(10, 0), INDEX_ELEM(12, 1),
+);
+
+IPCT_DECLARE_TUPLE_ELEMS(dense_opt,
+	INDEX_ELEM(14, 2), INDEX_ELEM(16, 3),
+);
+
+static const struct ipct_action_struct_desc dense_desc = {
+	.size		= sizeof(struct index_words),
+	.mandatory	= IPCT_TUPLES(dense_man),
+	.optional	= IPCT_TUPLES(dense_opt),
+};
+
+/* the optional array covers a mandatory ID */
+IPCT_DECLARE_TUPLE_ELEMS(dup_opt,
+	IPCT_TUPLE_ELEM_ARRAY(699, ipct_type_uint32_value,
+			      offsetof(struct index_words, v[2]), 2, 0, -1U),
+);
+
+static const struct ipct_action_struct_desc dup_desc = {
+	.size		= sizeof(struct index_words),
+	.mandatory	= IPCT_TUPLES(sparse_man),
+	.optional	= IPCT_TUPLES(dup_opt),
+};
+
+static const struct ipct_action_def index_actions[] = {
+	IPCT_ACTION(INDEX_ACTION_SPARSE, index_words),
+	{.action_id = INDEX_ACTION_DENSE, .desc = &dense_desc},
+};
+
+IPCT_DECLARE_SUBCLASS(index, 0, index_actions);
+
+static const struct ipct_klass_def index_klass = {
+	.klass_id	= INDEX_KLASS,
+	.num_subklasses	= 1,
+	.subklass	= &index_subclass,
+};
+
+static const struct ipct_action_def dup_actions[] = {
+	{.action_id = 0, .desc = &dup_desc},
+};
+
+IPCT_DECLARE_SUBCLASS(dup, 0, dup_actions);
+
+static const struct ipct_klass_def dup_klass = {
+	.klass_id	= INDEX_KLASS + 1,
+	.num_subklasses	= 1,
+	.subklass	= &dup_subclass,
+};
+
+static int is_used(const uint16_t *ids, uint32_t id)
+{
+	int i;
+
+	for (i = 0; i < NUM_IDS; i++)
+		if (ids[i] == id)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Retag the last tuple with every unused tuple ID - the tuple must be
+ * ignored and never land in another member.
+ */
+static void test_action(struct ipct_context *ipct, uint32_t id,
+			const uint16_t *ids)
+{
+	struct index_words in, out;
+	struct ipct_tuple *tuple;
+	char msg[MSG_SIZE];
+	uint32_t tuple_id;
+	int size, i, stray = 0;
+
+	for (i = 0; i < NUM_IDS; i++)
+		in.v[i] = 0x100 + i;
+
+	size = ipct_ctx_msg_pack(ipct, id, &in, sizeof(in), msg, sizeof(msg),
+				 0, 0);
+	TEST_CHECK(size > 0);
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       NULL, NULL, NULL) == 0);
+	TEST_CHECK(!memcmp(&in, &out, sizeof(in)));
+
+	tuple = test_msg_tuple(msg, size, ids[NUM_IDS - 1]);
+	TEST_CHECK(tuple != NULL);
+	if (!tuple)
+		return;
+
+	for (tuple_id = 0; tuple_id <= IPCT_TUPLE_MAX_ID; tuple_id++) {
+		if (is_used(ids, tuple_id))
+			continue;
+
+		tuple->id = tuple_id;
+		out.v[NUM_IDS - 1] = UNUSED;
+		if (ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+					NULL, NULL, NULL) ||
+		    memcmp(&in, &out, sizeof(in) - sizeof(in.v[0])) ||
+		    out.v[NUM_IDS - 1] != UNUSED)
+			stray++;
+	}
+
+	TEST_CHECK(stray == 0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &index_klass) == 0);
+	test_action(ipct, INDEX_ID(INDEX_ACTION_SPARSE), sparse_ids);
+	test_action(ipct, INDEX_ID(INDEX_ACTION_DENSE), dense_ids);
+
+	/* tuple IDs used twice */
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &dup_klass) < 0);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Scatter gather pack - messages packed into segments of any size, with
+ * tuples straddling segment boundaries, are the same bytes as the flat
+ * message and nothing is written past the message.
+ */
+
+#define MSG_SIZE	512
+#define MAX_SEGS	MSG_SIZE
+#define SEG_FILL	0xa5
+
+/* pack into segments of seg_len bytes and compare with the flat message */
+static int pack_segs(uint32_t id, void *src, size_t src_size,
+		     const void *flat, int size, size_t seg_len,
+		     uint32_t flags, uint32_t dest_addr)
+{
+	static struct ipct_iovec iov[MAX_SEGS];
+	uint8_t buf[MSG_SIZE + MAX_SEGS];
+	uint8_t out[MSG_SIZE];
+	int iovcnt, i, offset = 0, ret;
+
+	/* segments are apart in buf with a fill byte between them */
+	memset(buf, SEG_FILL, sizeof(buf));
+	iovcnt = (size + seg_len - 1) / seg_len;
+	for (i = 0; i < iovcnt; i++) {
+		iov[i].base = buf + i * (seg_len + 1);
+		iov[i].len = seg_len;
+	}
+
+	ret = ipct_msg_pack_iov(id, src, src_size, iov, iovcnt, flags,
+				dest_addr);
+	if (ret != size)
+		return -EINVAL;
+
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(out + offset, iov[i].base,
+		       i == iovcnt - 1 ? size - offset : seg_len);
+		offset += seg_len;
+
+		/* gap between segments is not written */
+		if (((uint8_t *)iov[i].base)[seg_len] != SEG_FILL)
+			return -EINVAL;
+	}
+
+	/* tail of last segment is not written */
+	for (i = size - (iovcnt - 1) * seg_len; i < seg_len; i++)
+		if (((uint8_t *)iov[iovcnt - 1].base)[i] != SEG_FILL)
+			return -EINVAL;
+
+	return memcmp(out, flat, size) ? -EINVAL : 0;
+}
+
+static void test_action(uint32_t id, void *src, size_t src_size,
+			uint32_t flags, uint32_t dest_addr)
+{
+	char flat[MSG_SIZE];
+	int size, seg_len, bad = 0;
+
+	size = ipct_msg_pack(id, src, src_size, flat, sizeof(flat), flags,
+			     dest_addr);
+	TEST_CHECK(size > 0);
+	if (size <= 0)
+		return;
+
+	for (seg_len = 1; seg_len <= size; seg_len++)
+		if (pack_segs(id, src, src_size, flat, size, seg_len, flags,
+			      dest_addr))
+			bad++;
+
+	TEST_CHECK(bad == 0);
+}
+
+static void test_messages(void)
+{
+	struct test_params params;
+	struct test_block block = {1, 2, 3};
+	struct test_large large;
+
+	test_params_init(&params);
+	test_large_init(&large);
+
+	test_action(TEST_ID(TEST_ACTION_PARAMS), &params, sizeof(params), 0,
+		    0);
+	test_action(TEST_ID(TEST_ACTION_PARAMS), &params, sizeof(params),
+		    IPCT_FLAGS_ROUTE, 0x22);
+	test_action(TEST_ID(TEST_ACTION_LARGE), &large, sizeof(large), 0, 0);
+	test_action(TEST_ID(TEST_ACTION_BLOCK), &block, sizeof(block), 0, 0);
+}
+
+static void test_short(void)
+{
+	struct test_params params;
+	struct ipct_iovec iov[3];
+	uint8_t a[16], b[16];
+	int size;
+
+	test_params_init(&params);
+	size = ipct_msg_packed_size(TEST_ID(TEST_ACTION_PARAMS), 0, 0);
+	TEST_CHECK(size > sizeof(a) + sizeof(b));
+
+	/* segments too small and nothing written */
+	memset(a, SEG_FILL, sizeof(a));
+	memset(b, SEG_FILL, sizeof(b));
+	iov[0].base = a;
+	iov[0].len = sizeof(a);
+	iov[1].base = NULL;
+	iov[1].len = 0;
+	iov[2].base = b;
+	iov[2].len = sizeof(b);
+	TEST_CHECK(ipct_msg_pack_iov(TEST_ID(TEST_ACTION_PARAMS), &params,
+				     sizeof(params), iov, 3, 0, 0) == -ENOSPC);
+	TEST_CHECK(a[0] == SEG_FILL && b[0] == SEG_FILL);
+
+	/* unknown action */
+	TEST_CHECK(ipct_msg_pack_iov(TEST_ID(255), &params, sizeof(params),
+				     iov, 3, 0, 0) == -EINVAL);
+}
+
+/* empty segments are skipped */
+static void test_empty_segs(void)
+{
+	struct test_params in, out;
+	struct ipct_iovec iov[4];
+	uint8_t a[MSG_SIZE], flat[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in),
+			     flat, sizeof(flat), 0, 0);
+
+	iov[0].base = a;
+	iov[0].len = 0;
+	iov[1].base = a;
+	iov[1].len = 10;
+	iov[2].base = NULL;
+	iov[2].len = 0;
+	iov[3].base = a + 10;
+	iov[3].len = sizeof(a) - 10;
+	TEST_CHECK(ipct_msg_pack_iov(TEST_ID(TEST_ACTION_PARAMS), &in,
+				     sizeof(in), iov, 4, 0, 0) == size);
+	TEST_CHECK(!memcmp(a, flat, size));
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(a, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_messages();
+	test_short();
+	test_empty_segs();
+
+	return TEST_RESULT();
+}
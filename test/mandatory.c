@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Mandatory tuples - a message missing any mandatory tuple is rejected
+ * while missing optional tuples leave their members untouched.
+ */
+
+#define MSG_SIZE	512
+#define UNUSED_ID	100
+#define DEST_FILL	0x5a
+
+static int pack_params(void *msg)
+{
+	struct test_params in;
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     MSG_SIZE, 0, 0);
+	TEST_CHECK(size > 0);
+	return size;
+}
+
+/* retag the tuple starting at tuple ID with an ID the action does not use */
+static int retag(void *msg, size_t size, uint32_t id)
+{
+	struct ipct_tuple *tuple = test_msg_tuple(msg, size, id);
+
+	TEST_CHECK(tuple != NULL);
+	if (!tuple)
+		return -EINVAL;
+
+	tuple->id = UNUSED_ID;
+	return 0;
+}
+
+static void test_missing_mandatory(void)
+{
+	static const uint32_t ids[] = {TEST_PARAMS_ID, TEST_PARAMS_CHANNELS};
+	struct test_params out;
+	char msg[MSG_SIZE];
+	int size, i;
+
+	for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+		size = pack_params(msg);
+		if (retag(msg, size, ids[i]))
+			continue;
+
+		TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+					   NULL) == -EINVAL);
+	}
+}
+
+static void test_missing_optional(void)
+{
+	struct test_params in, out;
+	char msg[MSG_SIZE];
+	uint64_t fill;
+	int size;
+
+	test_params_init(&in);
+	size = pack_params(msg);
+	if (retag(msg, size, TEST_PARAMS_STAMP))
+		return;
+
+	memset(&fill, DEST_FILL, sizeof(fill));
+	memset(&out, DEST_FILL, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(out.stamp == fill);
+
+	/* everything else was received */
+	out.stamp = in.stamp;
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_missing_mandatory();
+	test_missing_optional();
+
+	return TEST_RESULT();
+}
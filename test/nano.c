@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * Nano and micro messages - 4 byte header only and 8 byte header and micro
+ * tuple messages keep their ID, flags and tuple. They can't be routed and
+ * the classifier rejects any other message without elems.
+ */
+
+#define MSG_SIZE	512
+#define MSG_FLAGS	(IPCT_FLAGS_PRIORTY | IPCT_FLAGS_DATAGRAM)
+
+static void test_round_trip(void)
+{
+	uint32_t id, flags, tuple_id;
+	uint8_t msg[IPCT_MSG_MICRO_SIZE];
+	uint16_t value;
+
+	TEST_CHECK(ipct_msg_pack_nano(TEST_ID(TEST_ACTION_BLOCK), MSG_FLAGS,
+				      msg, sizeof(msg)) == IPCT_MSG_NANO_SIZE);
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_NANO_SIZE) ==
+		   IPCT_MSG_CLASS_NANO);
+	TEST_CHECK(ipct_msg_unpack_nano(msg, IPCT_MSG_NANO_SIZE, &id,
+					&flags) == 0);
+	TEST_CHECK(id == TEST_ID(TEST_ACTION_BLOCK));
+	TEST_CHECK(flags == MSG_FLAGS);
+
+	TEST_CHECK(ipct_msg_pack_micro(TEST_ID(TEST_ACTION_PARAMS), MSG_FLAGS,
+				       IPCT_TUPLE_MAX_ID, 0xbeef, msg,
+				       sizeof(msg)) == IPCT_MSG_MICRO_SIZE);
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_MICRO_SIZE) ==
+		   IPCT_MSG_CLASS_MICRO);
+	TEST_CHECK(ipct_msg_unpack_micro(msg, IPCT_MSG_MICRO_SIZE, &id, &flags,
+					 &tuple_id, &value) == 0);
+	TEST_CHECK(id == TEST_ID(TEST_ACTION_PARAMS));
+	TEST_CHECK(flags == MSG_FLAGS);
+	TEST_CHECK(tuple_id == IPCT_TUPLE_MAX_ID);
+	TEST_CHECK(value == 0xbeef);
+
+	/* each unpacker only takes its own class */
+	TEST_CHECK(ipct_msg_unpack_nano(msg, IPCT_MSG_MICRO_SIZE, &id,
+					&flags) == -EINVAL);
+	TEST_CHECK(ipct_msg_unpack_micro(msg, IPCT_MSG_NANO_SIZE, &id, &flags,
+					 &tuple_id, &value) == -EINVAL);
+}
+
+static void test_bad_pack(void)
+{
+	uint8_t msg[IPCT_MSG_MICRO_SIZE];
+
+	/* no route header */
+	TEST_CHECK(ipct_msg_pack_nano(TEST_ID(0), IPCT_FLAGS_ROUTE, msg,
+				      sizeof(msg)) == -EINVAL);
+	TEST_CHECK(ipct_msg_pack_nano(TEST_ID(0), IPCT_FLAGS_BROADCAST, msg,
+				      sizeof(msg)) == -EINVAL);
+	TEST_CHECK(ipct_msg_pack_micro(TEST_ID(0), IPCT_FLAGS_ROUTE, 1, 1, msg,
+				       sizeof(msg)) == -EINVAL);
+
+	/* dest too small */
+	TEST_CHECK(ipct_msg_pack_nano(TEST_ID(0), 0, msg,
+				      IPCT_MSG_NANO_SIZE - 1) == -EINVAL);
+	TEST_CHECK(ipct_msg_pack_micro(TEST_ID(0), 0, 1, 1, msg,
+				       IPCT_MSG_MICRO_SIZE - 1) == -EINVAL);
+
+	/* tuple ID must fit the tuple header */
+	TEST_CHECK(ipct_msg_pack_micro(TEST_ID(0), 0, IPCT_TUPLE_MAX_ID + 1, 1,
+				       msg, sizeof(msg)) == -EINVAL);
+}
+
+static void test_classify(void)
+{
+	struct test_params params;
+	struct ipct_tuple *tuple;
+	uint8_t msg[MSG_SIZE];
+	int size;
+
+	/* too small for a header */
+	ipct_msg_pack_nano(TEST_ID(0), 0, msg, sizeof(msg));
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_NANO_SIZE - 1) == -EINVAL);
+
+	/* no elems and not a nano or micro size */
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_NANO_SIZE + 2) == -EINVAL);
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_MICRO_SIZE + 4) == -EINVAL);
+
+	/* micro tuple must be a HD tuple */
+	ipct_msg_pack_micro(TEST_ID(0), 0, 1, 1, msg, sizeof(msg));
+	tuple = (struct ipct_tuple *)(msg + IPCT_MSG_NANO_SIZE);
+	tuple->type = IPCT_TUPLE_TYPE_STD;
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_MICRO_SIZE) == -EINVAL);
+
+	/* standard message */
+	test_params_init(&params);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &params,
+			     sizeof(params), msg, sizeof(msg), 0, 0);
+	TEST_CHECK(ipct_msg_classify(msg, size) == IPCT_MSG_CLASS_STD);
+	TEST_CHECK(ipct_msg_unpack_micro(msg, size, NULL, NULL, NULL,
+					 NULL) == -EINVAL);
+
+	/* routed messages are standard whatever their size */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &params,
+			     sizeof(params), msg, sizeof(msg),
+			     IPCT_FLAGS_ROUTE, 0x22);
+	TEST_CHECK(ipct_msg_classify(msg, IPCT_MSG_MICRO_SIZE) ==
+		   IPCT_MSG_CLASS_STD);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_round_trip();
+	test_bad_pack();
+	test_classify();
+
+	return TEST_RESULT();
+}
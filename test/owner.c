@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * Elem owners - each compiled elem belongs to the action or one of its
+ * subactions. A tuple ID is only matched against the elems of the structure
+ * it is packed in, so subaction IDs at the top level and top level IDs in a
+ * subaction entry never reach another structure.
+ */
+
+#define MSG_SIZE	512
+#define DEST_FILL	0x5a
+
+static int pack_params(void *msg)
+{
+	struct test_params in;
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     MSG_SIZE, 0, 0);
+	TEST_CHECK(size > 0);
+	return size;
+}
+
+/* the float gain tuple has the same shape as the uint32 route tuples */
+static void test_subaction_id(void)
+{
+	struct test_params in, out, fill;
+	struct ipct_tuple *tuple;
+	char msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = pack_params(msg);
+	tuple = test_msg_tuple(msg, size, TEST_PARAMS_GAIN);
+	TEST_CHECK(tuple != NULL);
+	if (!tuple)
+		return;
+
+	tuple->id = TEST_ROUTE_A;
+	memset(&fill, DEST_FILL, sizeof(fill));
+	memcpy(&out, &fill, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+
+	/* ignored - gain is not received and routes come from the array */
+	TEST_CHECK(out.gain == fill.gain);
+	out.gain = in.gain;
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+static void test_top_level_id(void)
+{
+	struct test_params in, out, fill;
+	struct ipct_elem_var_array *var;
+	struct ipct_tuple *tuple;
+	char msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = pack_params(msg);
+	tuple = test_msg_tuple(msg, size, TEST_ROUTE_A);
+	TEST_CHECK(tuple != NULL);
+	if (!tuple)
+		return;
+
+	/* first route entry tuple now uses the id and offset IDs */
+	var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+	tuple = (struct ipct_tuple *)var->data;
+	TEST_CHECK(tuple->id == TEST_ROUTE_A);
+	tuple->id = TEST_PARAMS_ID;
+
+	memset(&fill, DEST_FILL, sizeof(fill));
+	memcpy(&out, &fill, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+
+	/* ignored - id and offset come from the top level tuples */
+	TEST_CHECK(!memcmp(&out.route[0], &fill.route[0],
+			   sizeof(out.route[0])));
+	out.route[0] = in.route[0];
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_subaction_id();
+	test_top_level_id();
+
+	return TEST_RESULT();
+}
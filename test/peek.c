@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Header peek - the parsed headers match what was packed for plain,
+ * routed, block, compound and nano messages without reading the body, and
+ * headers or bodies past the end of the buffer are rejected.
+ */
+
+#define MSG_SIZE	512
+#define CTX_ADDR	0x11
+#define DEST_ADDR	0x22
+#define CHUNK_SIZE	64
+
+static void test_plain(void)
+{
+	struct test_params params;
+	struct ipct_msg_info info;
+	uint8_t msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&params);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &params,
+			     sizeof(params), msg, sizeof(msg),
+			     IPCT_FLAGS_PRIORTY, 0);
+	TEST_CHECK(size > 0);
+
+	/* body is not read */
+	memset(msg + size - 4, 0xff, 4);
+
+	TEST_CHECK(ipct_msg_peek(msg, size, &info) == 0);
+	TEST_CHECK(info.id == TEST_ID(TEST_ACTION_PARAMS));
+	TEST_CHECK(info.flags == IPCT_FLAGS_PRIORTY);
+	TEST_CHECK(info.receiver == 0 && info.sender == 0);
+	TEST_CHECK(info.num_tuples > 0);
+	TEST_CHECK(info.remaining == 0 && info.block == 0);
+	TEST_CHECK(info.hdr_size + info.size == size);
+
+	/* mailbox larger than the message */
+	TEST_CHECK(ipct_msg_peek(msg, sizeof(msg), &info) == 0);
+	TEST_CHECK(info.hdr_size + info.size == size);
+}
+
+static void test_routed(void)
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+	struct test_params params;
+	struct ipct_msg_info info;
+	uint8_t msg[MSG_SIZE];
+	int size;
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return;
+
+	ipct_ctx_set_addr(ipct, CTX_ADDR);
+	test_params_init(&params);
+	size = ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS), &params,
+				 sizeof(params), msg, sizeof(msg),
+				 IPCT_FLAGS_DATAGRAM, DEST_ADDR);
+	TEST_CHECK(size > 0);
+
+	TEST_CHECK(ipct_msg_peek(msg, size, &info) == 0);
+	TEST_CHECK(info.flags == (IPCT_FLAGS_ROUTE | IPCT_FLAGS_DATAGRAM));
+	TEST_CHECK(info.receiver == DEST_ADDR);
+	TEST_CHECK(info.sender == CTX_ADDR);
+	TEST_CHECK(info.hdr_size + info.size == size);
+
+	/* route header cut short */
+	TEST_CHECK(ipct_msg_peek(msg, info.hdr_size - 4, &info) == -EINVAL);
+
+	ipct_ctx_free(ipct);
+}
+
+static void test_block(void)
+{
+	struct test_block block = {1, 2, 3};
+	struct ipct_msg_info info;
+	uint8_t msg[MSG_SIZE];
+	int size;
+
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_BLOCK), &block, sizeof(block),
+			     msg, sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+
+	TEST_CHECK(ipct_msg_peek(msg, size, &info) == 0);
+	TEST_CHECK(info.id == TEST_ID(TEST_ACTION_BLOCK));
+	TEST_CHECK(info.block == 1);
+	TEST_CHECK(info.size >= sizeof(block));
+	TEST_CHECK(info.hdr_size + info.size == size);
+}
+
+/* each chunk has one less to follow */
+static void test_compound(void)
+{
+	struct ipct_msg_stream stream;
+	struct ipct_msg_info info;
+	struct test_large large;
+	uint8_t msg[CHUNK_SIZE];
+	int chunks, size, i;
+
+	test_large_init(&large);
+	chunks = ipct_msg_stream_init(&stream, TEST_ID(TEST_ACTION_LARGE),
+				      &large, sizeof(large), CHUNK_SIZE, 0, 0);
+	TEST_CHECK(chunks > 1);
+
+	for (i = 0; i < chunks; i++) {
+		size = ipct_msg_stream_next(&stream, msg, sizeof(msg));
+		TEST_CHECK(size > 0);
+		TEST_CHECK(ipct_msg_peek(msg, size, &info) == 0);
+		TEST_CHECK(info.id == TEST_ID(TEST_ACTION_LARGE));
+		TEST_CHECK(info.remaining == chunks - 1 - i);
+		TEST_CHECK(info.hdr_size + info.size == size);
+	}
+}
+
+static void test_nano(void)
+{
+	struct ipct_msg_info info;
+	uint32_t msg[MSG_SIZE / sizeof(uint32_t)];
+	struct ipct_tuple *tuple;
+	uint32_t i;
+
+	/* stale words that look like HD tuples follow the nano header */
+	for (i = 0; i < MSG_SIZE / sizeof(uint32_t); i++) {
+		tuple = (struct ipct_tuple *)&msg[i];
+		tuple->type = IPCT_TUPLE_TYPE_HD;
+		tuple->id = 1;
+		*(uint16_t *)(tuple + 1) = 1;
+	}
+
+	/* sized as nano or micro from the header */
+	ipct_msg_pack_nano(TEST_ID(TEST_ACTION_BLOCK), IPCT_FLAGS_PRIORTY, msg,
+			   sizeof(msg));
+	TEST_CHECK(ipct_msg_peek(msg, sizeof(msg), &info) == 0);
+	TEST_CHECK(info.id == TEST_ID(TEST_ACTION_BLOCK));
+	TEST_CHECK(info.flags == IPCT_FLAGS_PRIORTY);
+	TEST_CHECK(info.num_tuples == 0);
+	TEST_CHECK(!info.block);
+	TEST_CHECK(info.hdr_size + info.size == IPCT_MSG_NANO_SIZE);
+
+	ipct_msg_pack_micro(TEST_ID(TEST_ACTION_BLOCK), 0, 1, 2, msg,
+			    sizeof(msg));
+	TEST_CHECK(ipct_msg_peek(msg, sizeof(msg), &info) == 0);
+	TEST_CHECK(!info.block);
+	TEST_CHECK(info.hdr_size + info.size == IPCT_MSG_MICRO_SIZE);
+
+	/* micro tuple cut off */
+	TEST_CHECK(ipct_msg_peek(msg, IPCT_MSG_NANO_SIZE, &info) == -EINVAL);
+}
+
+static void test_truncated(void)
+{
+	struct test_params params;
+	struct ipct_msg_info info;
+	uint8_t msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&params);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &params,
+			     sizeof(params), msg, sizeof(msg), 0, 0);
+
+	/* no header, elems header cut short and body cut short */
+	TEST_CHECK(ipct_msg_peek(msg, 3, &info) == -EINVAL);
+	TEST_CHECK(ipct_msg_peek(msg, 4, &info) == -EINVAL);
+	TEST_CHECK(ipct_msg_peek(msg, size - 4, &info) == -EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_plain();
+	test_routed();
+	test_block();
+	test_compound();
+	test_nano();
+	test_truncated();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,181 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * Pack plan - tuples are packed in tuple ID order whatever the C member
+ * order and elems with sequential IDs of the same type are merged into one
+ * tuple array. Elems outside the C structure are rejected.
+ */
+
+#define PLAN_KLASS		4
+#define PLAN_ID			IPCT_ACTION_ID(PLAN_KLASS, 0, 0)
+
+#define PLAN_WORD		1	/* 1 - 3 */
+#define PLAN_HALF		10	/* 10 - 11 */
+#define PLAN_WIDE		20
+#define PLAN_LONE		22
+
+#define MSG_SIZE		256
+
+/* members are not in tuple ID order */
+struct plan_params {
+	uint16_t h0;		/* PLAN_HALF */
+	uint32_t w1;		/* PLAN_WORD + 1 */
+	uint16_t h1;		/* PLAN_HALF + 1 */
+	uint32_t w0;		/* PLAN_WORD */
+	uint64_t wide;		/* PLAN_WIDE */
+	uint32_t w2;		/* PLAN_WORD + 2 */
+	uint32_t lone;		/* PLAN_LONE */
+};
+
+IPCT_DECLARE_TUPLE_ELEMS(plan_man,
+	IPCT_TUPLE_ELEM(PLAN_LONE, ipct_type_uint32_value,
+			offsetof(struct plan_params, lone), 0, -1U),
+	IPCT_TUPLE_ELEM(PLAN_WORD + 2, ipct_type_uint32_value,
+			offsetof(struct plan_params, w2), 0, -1U),
+	IPCT_TUPLE_ELEM(PLAN_HALF, ipct_type_uint16_value,
+			offsetof(struct plan_params, h0), 0, 0xffff),
+	IPCT_TUPLE_ELEM(PLAN_WORD, ipct_type_uint32_value,
+			offsetof(struct plan_params, w0), 0, -1U),
+);
+
+IPCT_DECLARE_TUPLE_ELEMS(plan_opt,
+	IPCT_TUPLE_ELEM(PLAN_WIDE, ipct_type_uint64_value,
+			offsetof(struct plan_params, wide), 0, -1UL),
+	IPCT_TUPLE_ELEM(PLAN_HALF + 1, ipct_type_uint16_value,
+			offsetof(struct plan_params, h1), 0, 0xffff),
+	IPCT_TUPLE_ELEM(PLAN_WORD + 1, ipct_type_uint32_value,
+			offsetof(struct plan_params, w1), 0, -1U),
+);
+
+IPCT_DECLARE_ACTION_DESC(plan_params,
+		IPCT_TUPLES(plan_man),
+		IPCT_TUPLES(plan_opt),
+		0, IPCT_NOSUBACTION);
+
+IPCT_DECLARE_ACTIONS(plan,
+		IPCT_ACTION(0, plan_params),
+);
+
+IPCT_DECLARE_SUBCLASS(plan, 0, plan_actions);
+
+static const struct ipct_klass_def plan_klass = {
+	.klass_id	= PLAN_KLASS,
+	.num_subklasses	= 1,
+	.subklass	= &plan_subclass,
+};
+
+/* an elem that ends past the C structure */
+IPCT_DECLARE_TUPLE_ELEMS(bad_man,
+	IPCT_TUPLE_ELEM(PLAN_WORD, ipct_type_uint64_value,
+			offsetof(struct plan_params, lone), 0, -1UL),
+);
+
+static const struct ipct_action_struct_desc bad_desc = {
+	.size		= sizeof(struct plan_params),
+	.mandatory	= IPCT_TUPLES(bad_man),
+};
+
+static const struct ipct_action_def bad_actions[] = {
+	{.action_id = 0, .desc = &bad_desc},
+};
+
+IPCT_DECLARE_SUBCLASS(bad, 0, bad_actions);
+
+static const struct ipct_klass_def bad_klass = {
+	.klass_id	= PLAN_KLASS + 1,
+	.num_subklasses	= 1,
+	.subklass	= &bad_subclass,
+};
+
+static void test_plan(struct ipct_context *ipct)
+{
+	struct plan_params in, out;
+	struct ipct_elem_micro_array *micro;
+	struct ipct_elem_std *std;
+	struct ipct_tuple *tuple;
+	struct ipct_hdr *hdr;
+	char msg[MSG_SIZE];
+	int size, i;
+
+	memset(&in, 0, sizeof(in));
+	in.w0 = 0x10;
+	in.w1 = 0x11;
+	in.w2 = 0x12;
+	in.h0 = 0x20;
+	in.h1 = 0x21;
+	in.wide = 0x0102030405060708ULL;
+	in.lone = 0x30;
+
+	size = ipct_ctx_msg_pack(ipct, PLAN_ID, &in, sizeof(in), msg,
+				 sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+
+	/* word run, half run, wide and lone tuples in ID order */
+	hdr = (struct ipct_hdr *)msg;
+	TEST_CHECK(ipct_get_tuples(hdr) == 4);
+	tuple = IPCT_HDR_GET_TUPLE(hdr);
+
+	std = IPC_GET_STD_TUPLE(tuple);
+	TEST_CHECK(tuple->id == PLAN_WORD);
+	TEST_CHECK(tuple->type == IPCT_TUPLE_TYPE_STD_ARRAY);
+	TEST_CHECK(std->count == 3);
+	for (i = 0; i < 3; i++)
+		TEST_CHECK(std->data[i] == 0x10 + i);
+
+	tuple = (struct ipct_tuple *)ipc_next_tuple(tuple);
+	micro = IPC_GET_MICRO_TUPLE_ARRAY(tuple);
+	TEST_CHECK(tuple->id == PLAN_HALF);
+	TEST_CHECK(tuple->type == IPCT_TUPLE_TYPE_HD_ARRAY);
+	TEST_CHECK(micro->count == 2);
+	TEST_CHECK(micro->data[0] == 0x20 && micro->data[1] == 0x21);
+
+	tuple = (struct ipct_tuple *)ipc_next_tuple(tuple);
+	std = IPC_GET_STD_TUPLE(tuple);
+	TEST_CHECK(tuple->id == PLAN_WIDE);
+	TEST_CHECK(tuple->type == IPCT_TUPLE_TYPE_STD);
+	TEST_CHECK(std->size == 2);
+
+	/* not sequential with the wide tuple */
+	tuple = (struct ipct_tuple *)ipc_next_tuple(tuple);
+	TEST_CHECK(tuple->id == PLAN_LONE);
+	TEST_CHECK(tuple->type == IPCT_TUPLE_TYPE_STD);
+	TEST_CHECK((void *)ipc_next_tuple(tuple) == (void *)msg + size);
+
+	memset(&out, 0xff, sizeof(out));
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       NULL, NULL, NULL) == 0);
+	TEST_CHECK(out.w0 == in.w0 && out.w1 == in.w1 && out.w2 == in.w2);
+	TEST_CHECK(out.h0 == in.h0 && out.h1 == in.h1);
+	TEST_CHECK(out.wide == in.wide && out.lone == in.lone);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &plan_klass) == 0);
+	test_plan(ipct);
+
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &bad_klass) < 0);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
@@ -0,0 +1,231 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "test.h"
+
+/*
+ * Message buffer pool - buffers are sized from the largest message of each
+ * action, small gets borrow larger buffers, the pool runs dry instead of
+ * allocating and references are counted. Threads getting and putting at
+ * once never share a buffer.
+ */
+
+#define POOL_BUFS	2
+#define MAX_BUFS	64
+#define NUM_THREADS	8
+#define THREAD_BUFS	4
+#define THREAD_LOOPS	20000
+
+static const uint32_t pool_ids[] = {
+	TEST_ID(TEST_ACTION_PARAMS),
+	TEST_ID(TEST_ACTION_BLOCK),
+	TEST_ID(TEST_ACTION_LARGE),
+};
+
+/* get buffers of size until the pool is dry */
+static int pool_drain(struct ipct_msg_pool *pool, size_t size, void **bufs)
+{
+	int count = 0;
+
+	while (count < MAX_BUFS) {
+		bufs[count] = ipct_msg_pool_get(pool, size);
+		if (!bufs[count])
+			break;
+		count++;
+	}
+
+	return count;
+}
+
+static void test_classes(void)
+{
+	struct ipct_msg_pool *pool;
+	void *bufs[MAX_BUFS];
+	int i, j, size, count;
+
+	pool = ipct_msg_pool_create(pool_ids, ARRAY_SIZE(pool_ids), POOL_BUFS);
+	TEST_CHECK(pool != NULL);
+	if (!pool)
+		return;
+
+	/* every action has a buffer for its largest message */
+	for (i = 0; i < ARRAY_SIZE(pool_ids); i++) {
+		size = ipct_msg_max_size(pool_ids[i]);
+		bufs[0] = ipct_msg_pool_get(pool, size);
+		TEST_CHECK(bufs[0] != NULL);
+		if (!bufs[0])
+			continue;
+		TEST_CHECK(ipct_msg_pool_buf_size(pool, bufs[0]) >= size);
+		memset(bufs[0], 0, size);
+		TEST_CHECK(ipct_msg_pool_put(pool, bufs[0]) == 0);
+	}
+
+	/* small gets use any class and each buffer is handed out once */
+	count = pool_drain(pool, 1, bufs);
+	TEST_CHECK(count >= POOL_BUFS && count <= POOL_BUFS *
+		   ARRAY_SIZE(pool_ids));
+	TEST_CHECK(count % POOL_BUFS == 0);
+	for (i = 0; i < count; i++)
+		for (j = i + 1; j < count; j++)
+			TEST_CHECK(bufs[i] != bufs[j]);
+
+	/* dry */
+	TEST_CHECK(ipct_msg_pool_get(pool, 1) == NULL);
+
+	for (i = 0; i < count; i++)
+		TEST_CHECK(ipct_msg_pool_put(pool, bufs[i]) == 0);
+	TEST_CHECK(pool_drain(pool, 1, bufs) == count);
+	for (i = 0; i < count; i++)
+		TEST_CHECK(ipct_msg_pool_put(pool, bufs[i]) == 0);
+
+	/* larger than any class */
+	TEST_CHECK(ipct_msg_pool_get(pool, 1 << 20) == NULL);
+
+	ipct_msg_pool_destroy(pool);
+
+	/* unknown action */
+	TEST_CHECK(ipct_msg_pool_create((uint32_t[]){TEST_ID(255)}, 1,
+					POOL_BUFS) == NULL);
+}
+
+static void test_refs(void)
+{
+	struct ipct_msg_pool *pool;
+	uint32_t id = TEST_ID(TEST_ACTION_PARAMS);
+	uint8_t other[64];
+	void *buf, *again;
+
+	pool = ipct_msg_pool_create(&id, 1, 1);
+	TEST_CHECK(pool != NULL);
+	if (!pool)
+		return;
+
+	buf = ipct_msg_pool_get(pool, 1);
+	TEST_CHECK(buf != NULL);
+	if (!buf)
+		goto out;
+	TEST_CHECK(ipct_msg_pool_get(pool, 1) == NULL);
+
+	/* three owners - buffer is free after the third put */
+	TEST_CHECK(ipct_msg_pool_ref(pool, buf, 2) == 0);
+	TEST_CHECK(ipct_msg_pool_put(pool, buf) == 0);
+	TEST_CHECK(ipct_msg_pool_put(pool, buf) == 0);
+	TEST_CHECK(ipct_msg_pool_get(pool, 1) == NULL);
+	TEST_CHECK(ipct_msg_pool_put(pool, buf) == 0);
+
+	/* free buffers can't be put or referenced */
+	TEST_CHECK(ipct_msg_pool_put(pool, buf) == -EINVAL);
+	TEST_CHECK(ipct_msg_pool_ref(pool, buf, 1) == -EINVAL);
+
+	again = ipct_msg_pool_get(pool, 1);
+	TEST_CHECK(again == buf);
+
+	/* not pool buffers */
+	TEST_CHECK(ipct_msg_pool_ref(pool, buf, -1) == -EINVAL);
+	TEST_CHECK(ipct_msg_pool_put(pool, other) == -EINVAL);
+	TEST_CHECK(ipct_msg_pool_put(pool, buf + 4) == -EINVAL);
+	TEST_CHECK(ipct_msg_pool_buf_size(pool, other) == 0);
+
+	TEST_CHECK(ipct_msg_pool_put(pool, again) == 0);
+out:
+	ipct_msg_pool_destroy(pool);
+}
+
+struct worker {
+	pthread_t thread;
+	struct ipct_msg_pool *pool;
+	uint8_t tag;
+	int failures;
+};
+
+/* each held buffer is filled with the worker tag and must stay so */
+static void *worker_run(void *data)
+{
+	struct worker *worker = data;
+	void *bufs[THREAD_BUFS];
+	uint8_t *buf;
+	int i, j, k, size;
+
+	size = ipct_msg_max_size(TEST_ID(TEST_ACTION_PARAMS));
+
+	for (i = 0; i < THREAD_LOOPS; i++) {
+		for (j = 0; j < THREAD_BUFS; j++) {
+			bufs[j] = ipct_msg_pool_get(worker->pool, size);
+			if (!bufs[j]) {
+				worker->failures++;
+				break;
+			}
+			memset(bufs[j], worker->tag, size);
+		}
+
+		if (i & 1)
+			sched_yield();
+
+		while (j--) {
+			buf = bufs[j];
+			for (k = 0; k < size; k++)
+				if (buf[k] != worker->tag) {
+					worker->failures++;
+					break;
+				}
+			if (ipct_msg_pool_put(worker->pool, buf))
+				worker->failures++;
+		}
+	}
+
+	return NULL;
+}
+
+static void test_threads(void)
+{
+	struct worker workers[NUM_THREADS];
+	struct ipct_msg_pool *pool;
+	uint32_t id = TEST_ID(TEST_ACTION_PARAMS);
+	void *bufs[MAX_BUFS];
+	int i;
+
+	pool = ipct_msg_pool_create(&id, 1, NUM_THREADS * THREAD_BUFS);
+	TEST_CHECK(pool != NULL);
+	if (!pool)
+		return;
+
+	for (i = 0; i < NUM_THREADS; i++) {
+		workers[i].pool = pool;
+		workers[i].tag = i + 1;
+		workers[i].failures = 0;
+		TEST_CHECK(pthread_create(&workers[i].thread, NULL, worker_run,
+					  &workers[i]) == 0);
+	}
+
+	for (i = 0; i < NUM_THREADS; i++) {
+		TEST_CHECK(pthread_join(workers[i].thread, NULL) == 0);
+		TEST_CHECK(workers[i].failures == 0);
+	}
+
+	/* every buffer is back */
+	TEST_CHECK(pool_drain(pool, 1, bufs) == NUM_THREADS * THREAD_BUFS);
+	for (i = 0; i < NUM_THREADS * THREAD_BUFS; i++)
+		ipct_msg_pool_put(pool, bufs[i]);
+
+	ipct_msg_pool_destroy(pool);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_classes();
+	test_refs();
+	test_threads();
+
+	return TEST_RESULT();
+}
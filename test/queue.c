@@ -0,0 +1,227 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "test.h"
+
+/*
+ * Priority receive queue - high priority messages are taken first, a
+ * waiting normal message is taken after each burst, full levels return
+ * -ENOSPC and messages from many producers are all taken once in the order
+ * each producer put them.
+ */
+
+#define QUEUE_DEPTH	4
+#define QUEUE_BURST	2
+
+#define NUM_PRODUCERS	4
+#define PRODUCER_MSGS	20000
+
+/* nano message with the sequence in the action and subklass */
+static void msg_init(uint32_t *msg, uint32_t klass, uint32_t seq, int high)
+{
+	uint32_t subklass = seq >> 8;
+	uint32_t action = seq & 0xff;
+
+	ipct_msg_pack_nano(IPCT_ACTION_ID(klass, subklass, action),
+			   high ? IPCT_FLAGS_PRIORTY : 0, msg, sizeof(*msg));
+}
+
+static uint32_t msg_seq(const uint32_t *msg)
+{
+	return IPCT_ID_GET_SUBKLASS(*msg) << 8 | IPCT_ID_GET_ACTION(*msg);
+}
+
+static void test_order(void)
+{
+	/* normal 0 - 1 and high 2 - 6 */
+	static const uint32_t order[] = {2, 3, 0, 4, 5, 1, 6};
+	struct ipct_msg_queue *queue;
+	uint32_t msgs[7];
+	size_t size;
+	void *msg;
+	int i;
+
+	queue = ipct_msg_queue_create(QUEUE_DEPTH * 2, QUEUE_BURST);
+	TEST_CHECK(queue != NULL);
+	if (!queue)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(msgs); i++) {
+		msg_init(&msgs[i], 1, i, i >= 2);
+		TEST_CHECK(ipct_msg_queue_put(queue, &msgs[i],
+					      IPCT_MSG_NANO_SIZE) == 0);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(order); i++) {
+		TEST_CHECK(ipct_msg_queue_get(queue, &msg, &size) == 1);
+		TEST_CHECK(msg == &msgs[order[i]]);
+		TEST_CHECK(size == IPCT_MSG_NANO_SIZE);
+	}
+	TEST_CHECK(ipct_msg_queue_get(queue, &msg, &size) == 0);
+
+	/* no normal message waiting - high messages keep going */
+	for (i = 2; i < ARRAY_SIZE(msgs); i++)
+		ipct_msg_queue_put(queue, &msgs[i], IPCT_MSG_NANO_SIZE);
+	for (i = 2; i < ARRAY_SIZE(msgs); i++) {
+		TEST_CHECK(ipct_msg_queue_get(queue, &msg, &size) == 1);
+		TEST_CHECK(msg == &msgs[i]);
+	}
+
+	ipct_msg_queue_free(queue);
+}
+
+static void test_full(void)
+{
+	struct ipct_msg_queue *queue;
+	uint32_t msgs[QUEUE_DEPTH + 2];
+	size_t size;
+	void *msg;
+	int i;
+
+	queue = ipct_msg_queue_create(QUEUE_DEPTH, QUEUE_BURST);
+	TEST_CHECK(queue != NULL);
+	if (!queue)
+		return;
+
+	for (i = 0; i < QUEUE_DEPTH; i++) {
+		msg_init(&msgs[i], 1, i, 0);
+		TEST_CHECK(ipct_msg_queue_put(queue, &msgs[i],
+					      IPCT_MSG_NANO_SIZE) == 0);
+	}
+
+	/* normal level is full but high is not */
+	msg_init(&msgs[QUEUE_DEPTH], 1, QUEUE_DEPTH, 0);
+	TEST_CHECK(ipct_msg_queue_put(queue, &msgs[QUEUE_DEPTH],
+				      IPCT_MSG_NANO_SIZE) == -ENOSPC);
+	msg_init(&msgs[QUEUE_DEPTH + 1], 1, QUEUE_DEPTH + 1, 1);
+	TEST_CHECK(ipct_msg_queue_put(queue, &msgs[QUEUE_DEPTH + 1],
+				      IPCT_MSG_NANO_SIZE) == 0);
+
+	/* room again once a message is taken */
+	TEST_CHECK(ipct_msg_queue_get(queue, &msg, &size) == 1);
+	TEST_CHECK(msg == &msgs[QUEUE_DEPTH + 1]);
+	TEST_CHECK(ipct_msg_queue_get(queue, &msg, &size) == 1);
+	TEST_CHECK(msg == &msgs[0]);
+	TEST_CHECK(ipct_msg_queue_put(queue, &msgs[QUEUE_DEPTH],
+				      IPCT_MSG_NANO_SIZE) == 0);
+
+	/* malformed messages are not queued */
+	TEST_CHECK(ipct_msg_queue_put(queue, &msgs[0], 2) == -EINVAL);
+
+	ipct_msg_queue_free(queue);
+
+	TEST_CHECK(ipct_msg_queue_create(0, QUEUE_BURST) == NULL);
+	TEST_CHECK(ipct_msg_queue_create(QUEUE_DEPTH, 0) == NULL);
+}
+
+struct producer {
+	pthread_t thread;
+	struct ipct_msg_queue *queue;
+	uint32_t klass;
+	uint32_t *msgs;
+	int failures;
+};
+
+static void *producer_run(void *data)
+{
+	struct producer *producer = data;
+	int i, ret;
+
+	for (i = 0; i < PRODUCER_MSGS; i++) {
+		msg_init(&producer->msgs[i], producer->klass, i, i % 3 == 0);
+		do {
+			ret = ipct_msg_queue_put(producer->queue,
+						 &producer->msgs[i],
+						 IPCT_MSG_NANO_SIZE);
+			if (ret == -ENOSPC)
+				sched_yield();
+		} while (ret == -ENOSPC);
+
+		if (ret)
+			producer->failures++;
+	}
+
+	return NULL;
+}
+
+/* one consumer takes every message once in each producer order */
+static void test_producers(void)
+{
+	struct producer producers[NUM_PRODUCERS];
+	struct ipct_msg_queue *queue;
+	uint32_t next[NUM_PRODUCERS][2];
+	int total = 0, bad = 0, high, p, i;
+	uint32_t *msg, seq;
+	size_t size;
+
+	queue = ipct_msg_queue_create(QUEUE_DEPTH * 4, QUEUE_BURST);
+	TEST_CHECK(queue != NULL);
+	if (!queue)
+		return;
+
+	memset(next, 0, sizeof(next));
+	for (i = 0; i < NUM_PRODUCERS; i++) {
+		producers[i].queue = queue;
+		producers[i].klass = i + 1;
+		producers[i].failures = 0;
+		producers[i].msgs = calloc(PRODUCER_MSGS, sizeof(uint32_t));
+		TEST_CHECK(producers[i].msgs != NULL);
+		if (!producers[i].msgs)
+			return;
+	}
+
+	for (i = 0; i < NUM_PRODUCERS; i++)
+		TEST_CHECK(pthread_create(&producers[i].thread, NULL,
+					  producer_run, &producers[i]) == 0);
+
+	while (total < NUM_PRODUCERS * PRODUCER_MSGS) {
+		if (!ipct_msg_queue_get(queue, (void **)&msg, &size)) {
+			sched_yield();
+			continue;
+		}
+
+		/* in order per producer and priority - next[] is the lowest seq */
+		p = IPCT_ID_GET_KLASS(*msg) - 1;
+		seq = msg_seq(msg);
+		high = seq % 3 == 0;
+		if (p < 0 || p >= NUM_PRODUCERS ||
+		    msg != &producers[p].msgs[seq] ||
+		    seq < next[p][high])
+			bad++;
+		else
+			next[p][high] = seq + 1;
+		total++;
+	}
+
+	for (i = 0; i < NUM_PRODUCERS; i++) {
+		TEST_CHECK(pthread_join(producers[i].thread, NULL) == 0);
+		TEST_CHECK(producers[i].failures == 0);
+		free(producers[i].msgs);
+	}
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(ipct_msg_queue_get(queue, (void **)&msg, &size) == 0);
+
+	ipct_msg_queue_free(queue);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_order();
+	test_full();
+	test_producers();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Registry - action IDs resolve through the direct index tables and IDs
+ * outside the tables are rejected.
+ */
+
+#define MSG_SIZE	512
+
+/* IDs are 8 bits each */
+#define ID_COUNT	256
+
+static void test_round_trip(void)
+{
+	struct test_params in, out;
+	uint32_t id = 0, addr = 1;
+	char msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in),
+			     msg, sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), &id,
+				   &addr) == 0);
+	TEST_CHECK(id == TEST_ID(TEST_ACTION_PARAMS));
+	TEST_CHECK(addr == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+static void test_unknown_ids(void)
+{
+	static const uint32_t ids[] = {
+		IPCT_ACTION_ID(0, 0, 0),		/* no klass */
+		IPCT_ACTION_ID(255, 255, 255),		/* no klass */
+		IPCT_ACTION_ID(TEST_KLASS, 1, 0),	/* past subklasses */
+		IPCT_ACTION_ID(TEST_KLASS, 255, 0),
+		TEST_ID(4),				/* past actions */
+		TEST_ID(255),
+	};
+	struct test_params params;
+	struct ipct_hdr *hdr;
+	char msg[MSG_SIZE];
+	int i, size;
+
+	test_params_init(&params);
+
+	for (i = 0; i < ARRAY_SIZE(ids); i++) {
+		TEST_CHECK(ipct_msg_pack(ids[i], &params, sizeof(params), msg,
+					 sizeof(msg), 0, 0) == -EINVAL);
+		TEST_CHECK(ipct_msg_max_size(ids[i]) == -EINVAL);
+	}
+
+	/* receiver must reject a valid message with an unknown ID */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &params,
+			     sizeof(params), msg, sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+
+	hdr = (struct ipct_hdr *)msg;
+	hdr->action = 200;
+	TEST_CHECK(ipct_msg_unpack(msg, size, &params, sizeof(params), NULL,
+				   NULL) == -EINVAL);
+
+	hdr->action = TEST_ACTION_PARAMS;
+	hdr->subklass = 7;
+	TEST_CHECK(ipct_msg_unpack(msg, size, &params, sizeof(params), NULL,
+				   NULL) == -EINVAL);
+}
+
+/* bad klass definitions are rejected and leave the context unchanged */
+static void test_bad_klasses(void)
+{
+	const struct ipct_action_struct_desc *desc =
+		test_klass.subklass[0].actions[TEST_ACTION_PARAMS].desc;
+	const struct ipct_action_def dup_actions[] = {
+		{.action_id = 3, .desc = desc},
+		{.action_id = 3, .desc = desc},
+	};
+	const struct ipct_action_def big_actions[] = {
+		{.action_id = ID_COUNT, .desc = desc},
+	};
+	const struct ipct_subklass_def dup_subklass = {
+		.subclass_id = 0,
+		.num_actions = ARRAY_SIZE(dup_actions),
+		.actions = dup_actions,
+	};
+	const struct ipct_subklass_def big_subklass = {
+		.subclass_id = 0,
+		.num_actions = ARRAY_SIZE(big_actions),
+		.actions = big_actions,
+	};
+	struct ipct_klass_def klass = {
+		.klass_id = 5,
+		.num_subklasses = 1,
+	};
+	struct ipct_context *ipct;
+
+	ipct = ipct_ctx_create(NULL);
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return;
+
+	klass.subklass = &dup_subklass;
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &klass) < 0);
+
+	klass.subklass = &big_subklass;
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &klass) < 0);
+
+	klass.klass_id = ID_COUNT;
+	klass.subklass = &test_klass.subklass[0];
+	TEST_CHECK(ipct_ctx_register_klass(ipct, &klass) == -EINVAL);
+
+	TEST_CHECK(ipct_ctx_msg_max_size(ipct, IPCT_ACTION_ID(5, 0, 3)) ==
+		   -EINVAL);
+
+	ipct_ctx_free(ipct);
+}
+
+int main(int argc, char *argv[])
+{
+	test_round_trip();
+	test_unknown_ids();
+	test_bad_klasses();
+
+	return TEST_RESULT();
+}
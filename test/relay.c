@@ -0,0 +1,215 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Message relay - routed pool buffers are forwarded with only the route
+ * header rewritten. The caller reference is consumed on every path so the
+ * single buffer of the pool is always back once receivers put theirs, and
+ * a forward that fails leaves the message unchanged.
+ */
+
+#define RELAY_ADDR	0x99
+#define PORT_A		0x10
+#define PORT_B		0x20
+#define PORT_B_NEXT	0x21
+#define PORT_C		0x30
+#define NUM_PORTS	3
+
+struct test_port {
+	struct ipct_msg_pool *pool;
+	int received;
+	int fail;
+	struct sof_ipct_route route;
+};
+
+static struct test_port ports[NUM_PORTS];
+
+/* receiver - records the route and drops its reference */
+static int port_send(void *arg, void *msg, size_t size)
+{
+	struct test_port *port = arg;
+
+	if (port->fail)
+		return -EIO;
+
+	memcpy(&port->route, (struct ipct_hdr *)msg + 1, sizeof(port->route));
+	port->received++;
+	return ipct_msg_pool_put(port->pool, msg);
+}
+
+static struct sof_ipct_route *msg_route(void *msg)
+{
+	return (struct sof_ipct_route *)((struct ipct_hdr *)msg + 1);
+}
+
+/* the pool has a single buffer - check it's back and hand it out again */
+static void *pool_buf(struct ipct_msg_pool *pool)
+{
+	void *buf = ipct_msg_pool_get(pool, sizeof(struct test_params));
+
+	TEST_CHECK(buf != NULL);
+	TEST_CHECK(ipct_msg_pool_get(pool, sizeof(struct test_params)) == NULL);
+	return buf;
+}
+
+static int pack(struct ipct_context *ipct, void *buf, size_t size,
+		uint32_t flags, uint32_t dest_addr)
+{
+	struct test_params params;
+
+	test_params_init(&params);
+	return ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS), &params,
+				 sizeof(params), buf, size, flags, dest_addr);
+}
+
+static void ports_reset(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_PORTS; i++) {
+		ports[i].received = 0;
+		ports[i].fail = 0;
+	}
+}
+
+static void test_unicast(struct ipct_context *ipct, struct ipct_msg_pool *pool,
+			 struct ipct_relay *relay)
+{
+	void *buf;
+	size_t buf_size;
+	int size;
+
+	ports_reset();
+	buf = pool_buf(pool);
+	buf_size = ipct_msg_pool_buf_size(pool, buf);
+
+	size = pack(ipct, buf, buf_size, 0, PORT_B);
+	TEST_CHECK(ipct_relay_forward(relay, buf, buf_size) == 1);
+	TEST_CHECK(ports[1].received == 1);
+	TEST_CHECK(ports[1].route.receiver == PORT_B_NEXT);
+	TEST_CHECK(ports[1].route.sender == RELAY_ADDR);
+	TEST_CHECK(!ports[0].received && !ports[2].received);
+
+	/* unknown receiver - buffer put back and message unchanged */
+	buf = pool_buf(pool);
+	size = pack(ipct, buf, buf_size, 0, 0x40);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_relay_forward(relay, buf, size) == -EINVAL);
+	TEST_CHECK(msg_route(buf)->receiver == 0x40);
+	TEST_CHECK(msg_route(buf)->sender == PORT_A);
+
+	/* not routed */
+	buf = pool_buf(pool);
+	size = pack(ipct, buf, buf_size, 0, 0);
+	TEST_CHECK(ipct_relay_forward(relay, buf, size) == -EINVAL);
+
+	/* headers truncated */
+	buf = pool_buf(pool);
+	pack(ipct, buf, buf_size, 0, PORT_B);
+	TEST_CHECK(ipct_relay_forward(relay, buf, sizeof(struct ipct_hdr)) ==
+		   -EINVAL);
+
+	/* port send failure */
+	buf = pool_buf(pool);
+	pack(ipct, buf, buf_size, 0, PORT_B);
+	ports[1].fail = 1;
+	TEST_CHECK(ipct_relay_forward(relay, buf, buf_size) == -EIO);
+
+	ipct_msg_pool_put(pool, pool_buf(pool));
+}
+
+static void test_broadcast(struct ipct_context *ipct,
+			   struct ipct_msg_pool *pool, struct ipct_relay *relay)
+{
+	char msg[512];
+	void *buf;
+	size_t buf_size;
+	int size;
+
+	/* every port but the sender */
+	ports_reset();
+	buf = pool_buf(pool);
+	buf_size = ipct_msg_pool_buf_size(pool, buf);
+	pack(ipct, buf, buf_size, IPCT_FLAGS_BROADCAST, 0);
+	TEST_CHECK(ipct_relay_forward(relay, buf, buf_size) == 2);
+	TEST_CHECK(!ports[0].received);
+	TEST_CHECK(ports[1].received == 1 && ports[2].received == 1);
+	TEST_CHECK(ports[1].route.receiver == SOF_IPCT_ROUTE_BROADCAST);
+	TEST_CHECK(ports[2].route.sender == RELAY_ADDR);
+
+	/* one port failing still drops its reference */
+	ports_reset();
+	buf = pool_buf(pool);
+	pack(ipct, buf, buf_size, IPCT_FLAGS_BROADCAST, 0);
+	ports[2].fail = 1;
+	TEST_CHECK(ipct_relay_forward(relay, buf, buf_size) == 1);
+	TEST_CHECK(ports[1].received == 1);
+
+	/* not a pool buffer - references can't be taken */
+	size = pack(ipct, msg, sizeof(msg), IPCT_FLAGS_BROADCAST, 0);
+	TEST_CHECK(ipct_relay_forward(relay, msg, size) == -EINVAL);
+	TEST_CHECK(msg_route(msg)->sender == PORT_A);
+
+	ipct_msg_pool_put(pool, pool_buf(pool));
+}
+
+int main(int argc, char *argv[])
+{
+	const uint32_t id = TEST_ID(TEST_ACTION_PARAMS);
+	struct ipct_relay_port relay_ports[NUM_PORTS];
+	struct ipct_context *ipct;
+	struct ipct_msg_pool *pool;
+	struct ipct_relay *relay;
+	int i;
+
+	test_quiet();
+
+	ipct = ipct_ctx_create(&builder_klasses);
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+	ipct_ctx_set_addr(ipct, PORT_A);
+
+	pool = ipct_ctx_msg_pool_create(ipct, &id, 1, 1);
+	TEST_CHECK(pool != NULL);
+	if (!pool)
+		return 1;
+
+	for (i = 0; i < NUM_PORTS; i++) {
+		ports[i].pool = pool;
+		relay_ports[i].send = port_send;
+		relay_ports[i].arg = &ports[i];
+		relay_ports[i].next_addr = 0;
+	}
+	relay_ports[0].addr = PORT_A;
+	relay_ports[1].addr = PORT_B;
+	relay_ports[1].next_addr = PORT_B_NEXT;
+	relay_ports[2].addr = PORT_C;
+
+	relay = ipct_relay_create(pool, RELAY_ADDR, relay_ports, NUM_PORTS);
+	TEST_CHECK(relay != NULL);
+	if (!relay)
+		return 1;
+
+	test_unicast(ipct, pool, relay);
+	test_broadcast(ipct, pool, relay);
+
+	/* duplicate port addresses */
+	relay_ports[2].addr = PORT_A;
+	TEST_CHECK(ipct_relay_create(pool, RELAY_ADDR, relay_ports,
+				     NUM_PORTS) == NULL);
+
+	ipct_relay_free(relay);
+	ipct_msg_pool_destroy(pool);
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Pack flags and route header - flags and addresses survive a round trip
+ * and truncated headers are rejected before they are read.
+ */
+
+#define MSG_SIZE	512
+#define SENDER		0x11
+#define RECEIVER	0x22
+
+static void test_flags(struct ipct_context *ipct)
+{
+	struct test_params in, out;
+	struct sof_ipct_route *route;
+	struct ipct_hdr *hdr;
+	uint32_t id, addr, flags;
+	char msg[MSG_SIZE];
+	int size, plain;
+
+	test_params_init(&in);
+
+	/* no flags - no route header */
+	plain = ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS), &in,
+				  sizeof(in), msg, sizeof(msg), 0, 0);
+	TEST_CHECK(plain > 0);
+	hdr = (struct ipct_hdr *)msg;
+	TEST_CHECK(!hdr->route && !hdr->priority && !hdr->datagram);
+
+	size = ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS), &in,
+				 sizeof(in), msg, sizeof(msg),
+				 IPCT_FLAGS_PRIORTY | IPCT_FLAGS_DATAGRAM |
+				 IPCT_FLAGS_REPLY_NACK, RECEIVER);
+	TEST_CHECK(size == plain + sizeof(struct sof_ipct_route));
+	TEST_CHECK(hdr->route && hdr->priority && hdr->datagram &&
+		   hdr->status);
+
+	route = (struct sof_ipct_route *)(hdr + 1);
+	TEST_CHECK(route->receiver == RECEIVER);
+	TEST_CHECK(route->sender == SENDER);
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       &id, &addr, &flags) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+	TEST_CHECK(addr == RECEIVER);
+	TEST_CHECK(flags == (IPCT_FLAGS_PRIORTY | IPCT_FLAGS_DATAGRAM |
+			     IPCT_FLAGS_REPLY_NACK | IPCT_FLAGS_ROUTE));
+
+	/* broadcast overrides the receiver */
+	size = ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS), &in,
+				 sizeof(in), msg, sizeof(msg),
+				 IPCT_FLAGS_BROADCAST, RECEIVER);
+	TEST_CHECK(size == plain + sizeof(struct sof_ipct_route));
+	TEST_CHECK(route->receiver == SOF_IPCT_ROUTE_BROADCAST);
+	TEST_CHECK(ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out),
+				       &id, &addr, &flags) == 0);
+	TEST_CHECK(flags == (IPCT_FLAGS_BROADCAST | IPCT_FLAGS_ROUTE));
+}
+
+/* unpack bytes of data copied to a buffer of exactly size bytes */
+static int unpack_exact(struct ipct_context *ipct, const void *data,
+			size_t size)
+{
+	struct test_params out;
+	void *msg = malloc(size ? size : 1);
+	int ret;
+
+	memcpy(msg, data, size);
+	ret = ipct_ctx_msg_unpack(ipct, msg, size, &out, sizeof(out), NULL,
+				  NULL, NULL);
+	free(msg);
+
+	return ret;
+}
+
+static void test_truncated(struct ipct_context *ipct)
+{
+	struct test_params in;
+	struct ipct_hdr hdr;
+	char msg[MSG_SIZE];
+	int size, len;
+
+	/* header only with route or elems bits - nothing else is there */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.klass = TEST_KLASS;
+	hdr.route = 1;
+	TEST_CHECK(unpack_exact(ipct, &hdr, sizeof(hdr)) == -EINVAL);
+
+	hdr.route = 0;
+	hdr.elems = 1;
+	TEST_CHECK(unpack_exact(ipct, &hdr, sizeof(hdr)) == -EINVAL);
+
+	/* every prefix of a routed message */
+	test_params_init(&in);
+	size = ipct_ctx_msg_pack(ipct, TEST_ID(TEST_ACTION_PARAMS), &in,
+				 sizeof(in), msg, sizeof(msg),
+				 IPCT_FLAGS_BROADCAST, 0);
+	TEST_CHECK(size > 0);
+
+	for (len = 0; len < size; len++)
+		TEST_CHECK(unpack_exact(ipct, msg, len) < 0);
+	TEST_CHECK(unpack_exact(ipct, msg, size) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+	ipct_ctx_set_addr(ipct, SENDER);
+
+	test_flags(ipct);
+	test_truncated(ipct);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Message sizes - the packed size predicted for an action, flags and
+ * dest_addr is the size ipct_msg_pack() creates and never more than the
+ * worst case size of the action.
+ */
+
+#define MSG_SIZE	1024
+
+static const uint32_t test_flags[] = {
+	IPCT_FLAGS_NONE,
+	IPCT_FLAGS_PRIORTY | IPCT_FLAGS_DATAGRAM,
+	IPCT_FLAGS_REPLY_NACK,
+	IPCT_FLAGS_REPLY_ACK,
+	IPCT_FLAGS_BROADCAST,
+	IPCT_FLAGS_ROUTE,
+};
+
+static const uint32_t test_addr[] = {0, 0x22};
+
+static void test_action(struct ipct_context *ipct, uint32_t id, void *src,
+			size_t src_size)
+{
+	char msg[MSG_SIZE];
+	int size, packed, max, i, j;
+
+	max = ipct_ctx_msg_max_size(ipct, id);
+	TEST_CHECK(max > 0);
+
+	for (i = 0; i < sizeof(test_flags) / sizeof(test_flags[0]); i++) {
+		for (j = 0; j < sizeof(test_addr) / sizeof(test_addr[0]); j++) {
+			packed = ipct_ctx_msg_packed_size(ipct, id,
+							  test_flags[i],
+							  test_addr[j]);
+			size = ipct_ctx_msg_pack(ipct, id, src, src_size, msg,
+						 sizeof(msg), test_flags[i],
+						 test_addr[j]);
+			TEST_CHECK(size > 0);
+			TEST_CHECK(packed == size);
+			TEST_CHECK(size <= max);
+
+			/* exactly the predicted size is enough */
+			TEST_CHECK(ipct_ctx_msg_pack(ipct, id, src, src_size,
+						     msg, packed,
+						     test_flags[i],
+						     test_addr[j]) == size);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+	struct test_block_words words = {1, 2};
+	struct test_block block = {1, 2, 3};
+	struct test_params params;
+	struct test_large large;
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+	ipct_ctx_set_addr(ipct, 0x11);
+
+	test_params_init(&params);
+	test_large_init(&large);
+
+	test_action(ipct, TEST_ID(TEST_ACTION_PARAMS), &params, sizeof(params));
+	test_action(ipct, TEST_ID(TEST_ACTION_BLOCK), &block, sizeof(block));
+	test_action(ipct, TEST_ID(TEST_ACTION_LARGE), &large, sizeof(large));
+	test_action(ipct, TEST_ID(TEST_ACTION_BLOCK_WORDS), &words,
+		    sizeof(words));
+
+	/* unknown action */
+	TEST_CHECK(ipct_ctx_msg_packed_size(ipct, TEST_ID(255), 0, 0) ==
+		   -EINVAL);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
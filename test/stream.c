@@ -0,0 +1,183 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Compound messages - a stream of chunks reassembles into the C structure,
+ * chunks out of sequence or truncated are rejected.
+ */
+
+#define CHUNKS		4
+#define CHUNK_TUPLES	(TEST_LARGE_WORDS / CHUNKS)
+#define TUPLE_BYTES	(sizeof(struct ipct_elem_std) + sizeof(uint32_t))
+#define HDR_BYTES	(sizeof(struct ipct_hdr) + sizeof(struct sof_ipct_elems))
+#define CHUNK_SIZE	(HDR_BYTES + sizeof(struct sof_ipct_route) + \
+			 CHUNK_TUPLES * TUPLE_BYTES)
+
+struct chunk {
+	char data[CHUNK_SIZE];
+	int size;
+};
+
+static int pack_chunks(struct ipct_context *ipct, struct test_large *in,
+		       struct chunk *chunk, uint32_t dest_addr)
+{
+	struct ipct_msg_stream stream;
+	int i, ret;
+
+	ret = ipct_ctx_msg_stream_init(ipct, &stream, TEST_ID(TEST_ACTION_LARGE),
+				       in, sizeof(*in), CHUNK_SIZE, 0,
+				       dest_addr);
+	TEST_CHECK(ret == CHUNKS);
+	if (ret != CHUNKS)
+		return -EINVAL;
+
+	for (i = 0; i < CHUNKS; i++) {
+		chunk[i].size = ipct_msg_stream_next(&stream, chunk[i].data,
+						     sizeof(chunk[i].data));
+		TEST_CHECK(chunk[i].size > 0);
+	}
+
+	/* stream is done */
+	TEST_CHECK(ipct_msg_stream_next(&stream, chunk[0].data,
+					sizeof(chunk[0].data)) == 0);
+	return 0;
+}
+
+static void test_reassemble(struct ipct_context *ipct)
+{
+	struct chunk chunk[CHUNKS];
+	struct test_large in, out;
+	struct ipct_msg_stream stream;
+	struct ipct_msg_reasm reasm;
+	int i;
+
+	test_large_init(&in);
+	if (pack_chunks(ipct, &in, chunk, 0) < 0)
+		return;
+
+	memset(&out, 0, sizeof(out));
+	ipct_ctx_msg_reasm_init(ipct, &reasm, &out, sizeof(out));
+	for (i = 0; i < CHUNKS; i++)
+		TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[i].data,
+					      chunk[i].size) ==
+			   CHUNKS - 1 - i);
+
+	TEST_CHECK(!memcmp(&in, &out, sizeof(in)));
+	TEST_CHECK(reasm.id == TEST_ID(TEST_ACTION_LARGE));
+
+	/* too small for the header or for one tuple */
+	TEST_CHECK(ipct_ctx_msg_stream_init(ipct, &(struct ipct_msg_stream){},
+					    TEST_ID(TEST_ACTION_LARGE), &in,
+					    sizeof(in), HDR_BYTES, 0, 0) ==
+		   -ENOSPC);
+	TEST_CHECK(ipct_ctx_msg_stream_init(ipct, &(struct ipct_msg_stream){},
+					    TEST_ID(TEST_ACTION_LARGE), &in,
+					    sizeof(in), HDR_BYTES + 4, 0, 0) ==
+		   -ENOSPC);
+
+	/* dest smaller than the chunk */
+	TEST_CHECK(ipct_ctx_msg_stream_init(ipct, &stream,
+					    TEST_ID(TEST_ACTION_LARGE), &in,
+					    sizeof(in), CHUNK_SIZE, 0, 0) ==
+		   CHUNKS);
+	TEST_CHECK(ipct_msg_stream_next(&stream, chunk[0].data, HDR_BYTES) ==
+		   -ENOSPC);
+}
+
+static void test_sequence(struct ipct_context *ipct)
+{
+	struct chunk chunk[CHUNKS];
+	struct test_large in, out;
+	struct ipct_msg_reasm reasm;
+
+	test_large_init(&in);
+	if (pack_chunks(ipct, &in, chunk, 0) < 0)
+		return;
+
+	/* skipped chunk */
+	ipct_ctx_msg_reasm_init(ipct, &reasm, &out, sizeof(out));
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[0].data,
+				      chunk[0].size) == CHUNKS - 1);
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[2].data,
+				      chunk[2].size) == -EINVAL);
+
+	/* a failed chunk drops the message - the next must be a first */
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[0].data,
+				      chunk[0].size) == CHUNKS - 1);
+
+	/* first chunk lost */
+	ipct_ctx_msg_reasm_init(ipct, &reasm, &out, sizeof(out));
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[1].data,
+				      chunk[1].size) == -EINVAL);
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[0].data,
+				      chunk[0].size) == CHUNKS - 1);
+
+		/* last chunk alone is missing the mandatory tuples */
+	ipct_ctx_msg_reasm_init(ipct, &reasm, &out, sizeof(out));
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, chunk[CHUNKS - 1].data,
+				      chunk[CHUNKS - 1].size) == -EINVAL);
+}
+
+static void test_truncated(struct ipct_context *ipct)
+{
+	struct chunk chunk[CHUNKS];
+	struct test_large in, out;
+	struct ipct_msg_reasm reasm;
+	struct ipct_hdr *hdr;
+	void *msg;
+	int len;
+
+	test_large_init(&in);
+	if (pack_chunks(ipct, &in, chunk, 0x33) < 0)
+		return;
+
+	/* every prefix of a routed chunk in a buffer of its exact size */
+	for (len = 0; len <= chunk[0].size; len++) {
+		msg = malloc(len ? len : 1);
+		memcpy(msg, chunk[0].data, len);
+		ipct_ctx_msg_reasm_init(ipct, &reasm, &out, sizeof(out));
+		if (len < chunk[0].size)
+			TEST_CHECK(ipct_msg_reasm_add(&reasm, msg, len) < 0);
+		else
+			TEST_CHECK(ipct_msg_reasm_add(&reasm, msg, len) ==
+				   CHUNKS - 1);
+		free(msg);
+	}
+
+	/* header only with route and elems bits */
+	msg = malloc(sizeof(*hdr));
+	memcpy(msg, chunk[0].data, sizeof(*hdr));
+	hdr = msg;
+	TEST_CHECK(hdr->route && hdr->elems);
+	ipct_ctx_msg_reasm_init(ipct, &reasm, &out, sizeof(out));
+	TEST_CHECK(ipct_msg_reasm_add(&reasm, msg, sizeof(*hdr)) == -EINVAL);
+	free(msg);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ipct_context *ipct = ipct_ctx_create(&builder_klasses);
+
+	test_quiet();
+
+	TEST_CHECK(ipct != NULL);
+	if (!ipct)
+		return 1;
+
+	test_reassemble(ipct);
+	test_sequence(ipct);
+	test_truncated(ipct);
+
+	ipct_ctx_free(ipct);
+	return TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * Subactions - C arrays of structures are packed as a TUPLE_ARRAY tuple
+ * with one word aligned entry per structure. The array must fit the C array
+ * and its reserved word must be 0.
+ */
+
+#define MSG_SIZE	512
+
+static void test_round_trip(void)
+{
+	struct test_params in, out;
+	struct ipct_elem_var_array *var;
+	struct ipct_tuple *tuple;
+	char msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+
+	tuple = test_msg_tuple(msg, size, TEST_ROUTE_A);
+	TEST_CHECK(tuple != NULL);
+	if (!tuple)
+		return;
+
+	var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+	TEST_CHECK(tuple->type == IPCT_TUPLE_TYPE_TUPLE_ARRAY);
+	TEST_CHECK(var->count == TEST_ROUTE_SIZE);
+	TEST_CHECK(var->reserved == 0);
+	TEST_CHECK(!(var->elem_bytes & 3));
+	TEST_CHECK(!(((void *)var->data - (void *)msg) & 3));
+
+	memset(&out, 0, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == 0);
+	TEST_CHECK(test_params_equal(&in, &out));
+}
+
+static void test_malformed(void)
+{
+	struct test_params in, out;
+	struct ipct_msg_view view;
+	struct ipct_elem_var_array *var;
+	struct ipct_tuple *tuple;
+	char msg[MSG_SIZE];
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	tuple = test_msg_tuple(msg, size, TEST_ROUTE_A);
+	TEST_CHECK(tuple != NULL);
+	if (!tuple)
+		return;
+	var = IPC_GET_VAR_TUPLE_ARRAY(tuple);
+
+	/* reserved must be 0 - for unpack and views */
+	var->reserved = 1;
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	TEST_CHECK(ipct_msg_view_init(&view, msg, size) == -EINVAL);
+	var->reserved = 0;
+	TEST_CHECK(ipct_msg_view_init(&view, msg, size) == 0);
+
+	/* more entries than the C array */
+	var->count = TEST_ROUTE_SIZE + 1;
+	TEST_CHECK(ipct_msg_unpack(msg, size + var->elem_bytes, &out,
+				   sizeof(out), NULL, NULL) == -EINVAL);
+	var->count = TEST_ROUTE_SIZE;
+
+	/* entries not word aligned */
+	var->elem_bytes -= 2;
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	var->elem_bytes += 2;
+
+	/* entry value out of range */
+	in.route[1].a = 1001;
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_round_trip();
+	test_malformed();
+
+	return TEST_RESULT();
+}
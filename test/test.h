@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#ifndef __IPCT_TEST_H__
+#define __IPCT_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <ipct/client.h>
+#include <ipct/builder.h>
+
+/*
+ * Unit tests - each test is an executable run by ctest that returns non
+ * zero if any check failed. The test klass below is linked in as the
+ * builder_klasses of the default context.
+ */
+
+extern int test_failures;
+
+#define TEST_CHECK(cond)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__FILE__, __LINE__, #cond);		\
+			test_failures++;				\
+		}							\
+	} while (0)
+
+/* result of a test executable */
+#define TEST_RESULT()	(test_failures ? 1 : 0)
+
+/* the library logs every message - tests with many messages drop it */
+void test_quiet(void);
+
+/* test klass and actions */
+#define TEST_KLASS		1
+#define TEST_SUBKLASS		0
+
+#define TEST_ACTION_PARAMS	0
+#define TEST_ACTION_BLOCK	1
+#define TEST_ACTION_LARGE	2
+#define TEST_ACTION_BLOCK_WORDS	3
+
+#define TEST_ID(action)	IPCT_ACTION_ID(TEST_KLASS, TEST_SUBKLASS, action)
+
+/* struct test_params tuple IDs */
+#define TEST_PARAMS_ID		0
+#define TEST_PARAMS_OFFSET	1
+#define TEST_PARAMS_CHANNELS	2
+#define TEST_PARAMS_FLAGS	3
+#define TEST_PARAMS_GAIN	4
+#define TEST_PARAMS_STAMP	5
+#define TEST_PARAMS_NAME	6
+#define TEST_PARAMS_LEVEL	7
+#define TEST_PARAMS_MAP		8	/* 8 - 11 */
+#define TEST_ROUTE_A		20
+#define TEST_ROUTE_B		21
+
+#define TEST_MAP_SIZE		4
+#define TEST_ROUTE_SIZE		2
+#define TEST_NAME_SIZE		8
+
+struct test_route {
+	uint32_t a;
+	uint32_t b;
+};
+
+struct test_params {
+	uint32_t id;				/**< 0 - 100 mandatory */
+	int32_t offset;				/**< -1000 - 1000 mandatory */
+	uint16_t channels;			/**< 1 - 8 mandatory */
+	uint8_t flags;				/**< mask 0x0f */
+	int8_t level;				/**< -20 - 20 */
+	float gain;				/**< 0.0 - 10.0 */
+	uint64_t stamp;
+	char name[TEST_NAME_SIZE];
+	uint16_t map[TEST_MAP_SIZE];		/**< 0 - 100 each */
+	struct test_route route[TEST_ROUTE_SIZE];	/**< a 0 - 1000 */
+};
+
+/* private data block - 6 bytes so the block is padded */
+struct test_block {
+	uint16_t a;
+	uint16_t b;
+	uint16_t c;
+};
+
+/* private data block - whole words so the block has no padding */
+struct test_block_words {
+	uint32_t a;
+	uint32_t b;
+};
+
+/* many top level tuples for compound messages */
+#define TEST_LARGE_WORDS	16
+
+struct test_large {
+	uint32_t v[TEST_LARGE_WORDS];
+};
+
+extern const struct ipct_klass_def test_klass;
+
+void test_params_init(struct test_params *params);
+int test_params_equal(const struct test_params *a,
+		      const struct test_params *b);
+void test_large_init(struct test_large *large);
+
+/* first tuple with tuple ID in packed message or NULL */
+struct ipct_tuple *test_msg_tuple(void *msg, size_t size, uint32_t id);
+
+/* top level tuple data of tuple ID in packed message or NULL */
+void *test_msg_data(void *msg, size_t size, uint32_t id);
+
+/* copy msg to reordered with its top level tuples in reverse order */
+#define TEST_MAX_TUPLES		16
+void test_msg_reverse(const void *msg, void *reordered);
+
+#endif
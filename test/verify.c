@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <private/message.h>
+
+#include "test.h"
+
+/*
+ * Unpack verify - the whole message is verified before anything is copied
+ * so a bad value or a truncated tuple late in the message leaves the C
+ * structure untouched in the packed and reordered layouts.
+ */
+
+#define MSG_SIZE	512
+#define DEST_FILL	0x5a
+
+/* unpack fails and leaves dest as it was */
+static void check_untouched(void *msg, size_t size)
+{
+	struct test_params out, fill;
+
+	memset(&fill, DEST_FILL, sizeof(fill));
+	memcpy(&out, &fill, sizeof(out));
+	TEST_CHECK(ipct_msg_unpack(msg, size, &out, sizeof(out), NULL,
+				   NULL) == -EINVAL);
+	TEST_CHECK(!memcmp(&out, &fill, sizeof(out)));
+}
+
+static int pack_params(void *msg)
+{
+	struct test_params in;
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     MSG_SIZE, 0, 0);
+	TEST_CHECK(size > 0);
+	return size;
+}
+
+static void test_late_value(void)
+{
+	char msg[MSG_SIZE], reordered[MSG_SIZE];
+	uint16_t *map;
+	int size;
+
+	/* last map elem is in the last tuple before the route array */
+	size = pack_params(msg);
+	map = test_msg_data(msg, size, TEST_PARAMS_MAP + TEST_MAP_SIZE - 1);
+	TEST_CHECK(map != NULL);
+	if (!map)
+		return;
+
+	*map = 101;
+	check_untouched(msg, size);
+
+	/* mandatory tuples are first once reordered */
+	test_msg_reverse(msg, reordered);
+	check_untouched(reordered, size);
+}
+
+static void test_truncated(void)
+{
+	char msg[MSG_SIZE], reordered[MSG_SIZE];
+	int size;
+
+	size = pack_params(msg);
+	test_msg_reverse(msg, reordered);
+
+	/* last tuple runs past the end of the message */
+	check_untouched(msg, size - sizeof(uint32_t));
+	check_untouched(reordered, size - sizeof(uint32_t));
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_late_value();
+	test_truncated();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright(c) 2020 Intel Corporation. All rights reserved.
+ *
+ * Author: Liam Girdwood <liam.r.girdwood@linux.intel.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+
+/*
+ * Message views - top level tuple data is read in place with getters that
+ * must match the elem type and size. Messages that don't validate can't be
+ * viewed.
+ */
+
+#define MSG_SIZE	512
+
+static void test_get(void)
+{
+	struct ipct_msg_view view;
+	struct test_params in;
+	char msg[MSG_SIZE];
+	const void *data;
+	size_t data_size;
+	uint64_t u64;
+	uint32_t u32;
+	int32_t s32;
+	uint16_t u16;
+	uint8_t u8;
+	int8_t s8;
+	float f;
+	int size;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_msg_view_init(&view, msg, size) == 0);
+	TEST_CHECK(view.id == TEST_ID(TEST_ACTION_PARAMS));
+
+	TEST_CHECK(ipct_view_get_u32(&view, TEST_PARAMS_ID, &u32) == 0);
+	TEST_CHECK(u32 == in.id);
+	TEST_CHECK(ipct_view_get_s32(&view, TEST_PARAMS_OFFSET, &s32) == 0);
+	TEST_CHECK(s32 == in.offset);
+	TEST_CHECK(ipct_view_get_u16(&view, TEST_PARAMS_CHANNELS, &u16) == 0);
+	TEST_CHECK(u16 == in.channels);
+	TEST_CHECK(ipct_view_get_u8(&view, TEST_PARAMS_FLAGS, &u8) == 0);
+	TEST_CHECK(u8 == in.flags);
+	TEST_CHECK(ipct_view_get_s8(&view, TEST_PARAMS_LEVEL, &s8) == 0);
+	TEST_CHECK(s8 == in.level);
+	TEST_CHECK(ipct_view_get_float(&view, TEST_PARAMS_GAIN, &f) == 0);
+	TEST_CHECK(f == in.gain);
+	TEST_CHECK(ipct_view_get_u64(&view, TEST_PARAMS_STAMP, &u64) == 0);
+	TEST_CHECK(u64 == in.stamp);
+	TEST_CHECK(ipct_view_get_data(&view, TEST_PARAMS_NAME, &data,
+				      &data_size) == 0);
+	TEST_CHECK(data_size == TEST_NAME_SIZE);
+	TEST_CHECK(!memcmp(data, in.name, TEST_NAME_SIZE));
+
+	/* same size but another type */
+	TEST_CHECK(ipct_view_get_float(&view, TEST_PARAMS_ID, &f) == -EINVAL);
+	TEST_CHECK(ipct_view_get_s32(&view, TEST_PARAMS_ID, &s32) == -EINVAL);
+	TEST_CHECK(ipct_view_get_u32(&view, TEST_PARAMS_OFFSET, &u32) ==
+		   -EINVAL);
+	TEST_CHECK(ipct_view_get_u32(&view, TEST_PARAMS_GAIN, &u32) == -EINVAL);
+	TEST_CHECK(ipct_view_get_s8(&view, TEST_PARAMS_FLAGS, &s8) == -EINVAL);
+	TEST_CHECK(ipct_view_get_data(&view, TEST_PARAMS_ID, &data,
+				      &data_size) == -EINVAL);
+
+	/* same type but another size */
+	TEST_CHECK(ipct_view_get_u16(&view, TEST_PARAMS_ID, &u16) == -EINVAL);
+	TEST_CHECK(ipct_view_get_u32(&view, TEST_PARAMS_STAMP, &u32) ==
+		   -EINVAL);
+
+	/* unknown and subaction tuples can't be viewed */
+	TEST_CHECK(ipct_view_get_u32(&view, 15, &u32) == -ENOENT);
+	TEST_CHECK(ipct_view_get_u32(&view, TEST_ROUTE_A, &u32) == -ENOENT);
+}
+
+static void test_malformed(void)
+{
+	struct ipct_msg_view view;
+	struct test_params in;
+	char msg[MSG_SIZE];
+	void *exact;
+	int size, len;
+
+	test_params_init(&in);
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+
+	/* every prefix in a buffer of its exact size */
+	for (len = 0; len < size; len++) {
+		exact = malloc(len ? len : 1);
+		memcpy(exact, msg, len);
+		TEST_CHECK(ipct_msg_view_init(&view, exact, len) < 0);
+		free(exact);
+	}
+
+	/* value out of range */
+	in.channels = 9;
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_PARAMS), &in, sizeof(in), msg,
+			     sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_msg_view_init(&view, msg, size) == -EINVAL);
+
+	/* blocks have no tuples to view */
+	size = ipct_msg_pack(TEST_ID(TEST_ACTION_BLOCK),
+			     &(struct test_block){1, 2, 3},
+			     sizeof(struct test_block), msg, sizeof(msg), 0, 0);
+	TEST_CHECK(size > 0);
+	TEST_CHECK(ipct_msg_view_init(&view, msg, size) < 0);
+}
+
+int main(int argc, char *argv[])
+{
+	test_quiet();
+
+	test_get();
+	test_malformed();
+
+	return TEST_RESULT();
+}